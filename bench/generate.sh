@@ -0,0 +1,141 @@
+# Writes the benchmark guest programs to a directory:
+#
+#   bench/generate.sh <directory> [scale]
+#
+# Every workload stops with halt, scale multiplies its iteration count. The
+# stack grows down from 0xFFFFE000, below the page of the memory mapped
+# registers.
+#
+#   alu         arithmetic, logic and shift instructions in a tight loop
+#   memory      stores and loads streamed over a 64 KiB buffer
+#   calls       recursive fibonacci, a call and a ret for every step
+#   interrupts  software interrupts with an empty handler (int and iret)
+
+DIR=${1:?usage: generate.sh <directory> [scale]}
+SCALE=${2:-1}
+
+case ${SCALE} in
+  ''|*[!0-9]*|0*)
+    echo "usage: generate.sh <directory> [scale] (scale is a whole number of at least 1)" >&2
+    exit 1;;
+esac
+
+mkdir -p ${DIR}
+
+# ----------------------------------- ALU -------------------------------------
+
+cat > ${DIR}/alu.s << EOF
+.global start
+.section my_code
+start:
+    ld \$0xFFFFE000, %sp
+    ld \$$((2000000 * SCALE)), %r1
+    ld \$0, %r2
+    ld \$1, %r3
+    ld \$12345, %r4
+    ld \$3, %r5
+loop:
+    add %r5, %r4
+    mul %r5, %r4
+    xor %r1, %r4
+    shr %r3, %r4
+    and %r4, %r6
+    or %r4, %r6
+    sub %r3, %r1
+    bne %r1, %r2, loop
+    halt
+.end
+EOF
+
+# ---------------------------------- MEMORY -----------------------------------
+
+cat > ${DIR}/memory.s << EOF
+.global start
+.section my_code
+start:
+    ld \$0xFFFFE000, %sp
+    ld \$$((40 * SCALE)), %r1
+    ld \$0, %r2
+    ld \$1, %r3
+    ld \$4, %r8
+outer:
+    ld \$0x10000000, %r4
+    ld \$16384, %r5
+store:
+    st %r5, [%r4]
+    add %r8, %r4
+    sub %r3, %r5
+    bne %r5, %r2, store
+    ld \$0x10000000, %r4
+    ld \$16384, %r5
+load:
+    ld [%r4], %r7
+    add %r7, %r6
+    add %r8, %r4
+    sub %r3, %r5
+    bne %r5, %r2, load
+    sub %r3, %r1
+    bne %r1, %r2, outer
+    halt
+.end
+EOF
+
+# ----------------------------------- CALLS -----------------------------------
+
+cat > ${DIR}/calls.s << EOF
+.global start
+.section my_code
+start:
+    ld \$0xFFFFE000, %sp
+    ld \$$((40 * SCALE)), %r12
+    ld \$0, %r0
+    ld \$1, %r3
+    ld \$2, %r10
+    ld \$2, %r11
+repeat:
+    ld \$20, %r1
+    call fib
+    sub %r3, %r12
+    bne %r12, %r0, repeat
+    halt
+
+# r2 <= fib(r1)
+fib:
+    bgt %r10, %r1, base
+    push %r1
+    sub %r3, %r1
+    call fib
+    pop %r1
+    push %r2
+    sub %r11, %r1
+    call fib
+    pop %r4
+    add %r4, %r2
+    ret
+base:
+    ld %r1, %r2
+    ret
+.end
+EOF
+
+# -------------------------------- INTERRUPTS ---------------------------------
+
+cat > ${DIR}/interrupts.s << EOF
+.global start
+.section my_code
+start:
+    ld \$0xFFFFE000, %sp
+    ld \$isr, %r1
+    csrwr %r1, %handler
+    ld \$$((1000000 * SCALE)), %r1
+    ld \$0, %r2
+    ld \$1, %r3
+loop:
+    int
+    sub %r3, %r1
+    bne %r1, %r2, loop
+    halt
+isr:
+    iret
+.end
+EOF
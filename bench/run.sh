@@ -0,0 +1,58 @@
+# Runs the benchmark workloads (see generate.sh) on every emulator engine and
+# writes the results as JSON:
+#
+#   bench/run.sh [scale] [results.json]
+#
+# Tools are taken from ASSEMBLER, LINKER and EMULATOR like in start.sh. Time
+# is the emulator's own measurement of the run (--stats), loading the program
+# isn't counted. Peak RSS is the one of the whole emulator process.
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+LINKER=${LINKER:-./linker}
+EMULATOR=${EMULATOR:-./emulator}
+
+SCALE=${1:-1}
+RESULTS=${2:-/dev/stdout}
+
+WORKLOADS="alu memory calls interrupts"
+ENGINES="reference threaded block"
+
+WORK=$(mktemp -d)
+trap "rm -rf ${WORK}" EXIT
+
+sh $(dirname $0)/generate.sh ${WORK} ${SCALE} || exit 1
+
+for WORKLOAD in ${WORKLOADS}; do
+  ${ASSEMBLER} -o ${WORK}/${WORKLOAD}.o ${WORK}/${WORKLOAD}.s || exit 1
+  ${LINKER} -hex -place=my_code@0x40000000 -o ${WORK}/${WORKLOAD}.hex ${WORK}/${WORKLOAD}.o || exit 1
+done
+
+{
+  echo "{"
+  echo "  \"commit\": \"$(git -C $(dirname $0) rev-parse --short HEAD 2> /dev/null)\","
+  echo "  \"scale\": ${SCALE},"
+  echo "  \"results\": ["
+
+  SEPARATOR=""
+  for WORKLOAD in ${WORKLOADS}; do
+    for ENGINE in ${ENGINES}; do
+      ${EMULATOR} --engine=${ENGINE} --stats ${WORK}/${WORKLOAD}.hex < /dev/null > ${WORK}/stats.txt || exit 1
+
+      awk -v workload=${WORKLOAD} -v engine=${ENGINE} -v separator="${SEPARATOR}" '
+        $1 == "instructions" && NF == 2 { instructions = $2 }
+        $1 == "time"                    { seconds = $2 }
+        $1 == "peak"                    { rss = $3 }
+        END {
+          printf "%s    {\"workload\": \"%s\", \"engine\": \"%s\", \"instructions\": %d, \"seconds\": %.6f, ", separator, workload, engine, instructions, seconds
+          printf "\"mips\": %.1f, \"ns_per_instruction\": %.2f, \"peak_rss_kib\": %d}", \
+                 (seconds > 0 ? instructions / seconds / 1e6 : 0), (instructions > 0 ? seconds * 1e9 / instructions : 0), rss
+        }' ${WORK}/stats.txt
+
+      SEPARATOR=",\n"
+    done
+  done
+
+  echo ""
+  echo "  ]"
+  echo "}"
+} > ${RESULTS}
@@ -0,0 +1,49 @@
+# Writes assembly files for timing the assembler and the linker:
+#
+#   bench/toolchainGenerate.sh <directory> [files] [labels] [words] [literals] [externs]
+#
+# Every file (file0.s, file1.s, ...) has its code in section text and
+#   labels    global labels, each on an add instruction
+#   words     .word directives referencing labels of the file
+#   literals  ld of constants too big for the displacement (literal pool)
+#   externs   .word references to labels of the following file
+
+DIR=${1:?usage: toolchainGenerate.sh <directory> [files] [labels] [words] [literals] [externs]}
+FILES=${2:-16}
+LABELS=${3:-1000}
+WORDS=${4:-1000}
+LITERALS=${5:-1000}
+EXTERNS=${6:-100}
+
+mkdir -p ${DIR}
+
+awk -v dir=${DIR} -v files=${FILES} -v labels=${LABELS} -v words=${WORDS} \
+    -v literals=${LITERALS} -v externs=${EXTERNS} 'BEGIN {
+  for (f = 0; f < files; f++) {
+    out = dir "/file" f ".s"
+    next_file = (f + 1) % files
+
+    for (i = 0; i < labels; i++) print ".global f" f "_l" i > out
+
+    # A file referencing itself (files = 1) needs no externs
+    if (next_file != f)
+      for (i = 0; i < externs && i < labels; i++) print ".extern f" next_file "_l" i > out
+
+    print ".section text" > out
+
+    for (i = 0; i < labels; i++) {
+      print "f" f "_l" i ":" > out
+      print "    add %r1, %r2" > out
+    }
+
+    for (i = 0; i < literals; i++) printf "    ld $0x%x, %%r%d\n", 0x10000000 + i * 4097, 1 + i % 12 > out
+
+    for (i = 0; i < words; i++) print "    .word f" f "_l" (labels ? i % labels : 0) > out
+
+    for (i = 0; i < externs && i < labels; i++) print "    .word f" next_file "_l" i > out
+
+    print "    halt" > out
+    print ".end" > out
+    close(out)
+  }
+}'
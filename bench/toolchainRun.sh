@@ -0,0 +1,54 @@
+# Times the assembler and the linker stage by stage on generated files (see
+# toolchainGenerate.sh) and writes the results as JSON:
+#
+#   bench/toolchainRun.sh [files] [labels] [words] [literals] [externs] [results.json]
+#
+# Tools are taken from ASSEMBLER and LINKER like in start.sh. Assembler
+# stages are summed over all files. Run it with growing counts to see how a
+# stage scales.
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+LINKER=${LINKER:-./linker}
+
+FILES=${1:-16}
+LABELS=${2:-1000}
+WORDS=${3:-1000}
+LITERALS=${4:-1000}
+EXTERNS=${5:-100}
+RESULTS=${6:-/dev/stdout}
+
+WORK=$(mktemp -d)
+trap "rm -rf ${WORK}" EXIT
+
+sh $(dirname $0)/toolchainGenerate.sh ${WORK} ${FILES} ${LABELS} ${WORDS} ${LITERALS} ${EXTERNS}
+
+OBJECTS=""
+for i in $(seq 0 $((FILES - 1))); do
+  ${ASSEMBLER} --time -o ${WORK}/file${i}.o ${WORK}/file${i}.s >> ${WORK}/assembler.txt || exit 1
+  OBJECTS="${OBJECTS} ${WORK}/file${i}.o"
+done
+
+${LINKER} -hex -time -place=text@0x40000000 -o ${WORK}/program.hex ${OBJECTS} > ${WORK}/linker.txt || exit 1
+
+# Stage lines of one tool as a JSON object, stages in order of appearance
+stages() {
+  awk '$1 == "stage" {
+    if (!($2 in seconds)) order[count++] = $2
+    seconds[$2] += $3
+    total += $3
+  }
+  END {
+    printf "{"
+    for (i = 0; i < count; i++) printf "\"%s\": %.6f, ", order[i], seconds[order[i]]
+    printf "\"total\": %.6f}", total
+  }' $1
+}
+
+{
+  echo "{"
+  echo "  \"commit\": \"$(git -C $(dirname $0) rev-parse --short HEAD 2> /dev/null)\","
+  echo "  \"files\": ${FILES}, \"labels\": ${LABELS}, \"words\": ${WORDS}, \"literals\": ${LITERALS}, \"externs\": ${EXTERNS},"
+  echo "  \"assembler\": $(stages ${WORK}/assembler.txt),"
+  echo "  \"linker\": $(stages ${WORK}/linker.txt)"
+  echo "}"
+} > ${RESULTS}
@@ -2,6 +2,7 @@
 #define ASSEMBLER
 
 #include "myElf.h"
+#include "stageTimer.h"
 
 class Assembler {
 
@@ -78,9 +79,13 @@ public:
 
   // Helper functions
   static void setGlobal(char *);
+  static int findSymbol(char *);
+  static int findSection(char *);
   static void init();
   static void createMyElfSymbolTable();
   static void newRelocation(int, char *, MyElf::RelocationTypes, int);
+  static void resolveFixups();
+  static void closeSection();
   static char getByte(int, int);
   static void codeInstruction(char, char, char, char);
   static void literalPoolProcessing(char, char, char, char, char, char, char, int);
@@ -92,8 +97,9 @@ public:
   // Data structures
 
   static FILE *asmFile;
+  static bool textOutput; // readable object file instead of binary one
+  static StageTimer timer; // --time
   static unsigned locationCounter;
-  static bool first;
   static int currSecId;
   static string currSecName;
   static MyElf *myElf;
@@ -113,6 +119,7 @@ public:
   };
 
   static vector<Symbol*> symbolTable;
+  static NameIndex symbolIndex;
 
   struct Section {
     string name;
@@ -125,6 +132,39 @@ public:
   };
 
   static vector<Section*> sectionTable;
+  static NameIndex sectionIndex;
+
+  static void addSymbol(Symbol *);
+  static void addSection(Section *);
+
+  // Instruction whose literal pool displacement is known when its section is closed
+  struct PoolFixup {
+    unsigned offset;
+    int poolIndex;
+  };
+
+  static vector<PoolFixup> poolFixups;
+
+  // Word that needs a relocation, created at the end of file when all symbols are known
+  struct SymbolFixup {
+    int secId;
+    unsigned offset;   // of the word, or of the instruction if the word is in literal pool
+    int poolIndex;     // -1 if the word is not in literal pool
+    string symbol;
+    MyElf::RelocationTypes type;
+    int addend;
+
+    SymbolFixup(int sId, unsigned off, int pIdx, string sym, MyElf::RelocationTypes t, int add) {
+      secId = sId;
+      offset = off;
+      poolIndex = pIdx;
+      symbol = sym;
+      type = t;
+      addend = add;
+    }
+  };
+
+  static vector<SymbolFixup> symbolFixups;
 
 };
 
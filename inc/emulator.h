@@ -1,14 +1,20 @@
 #if !defined(EMULATOR)
 #define EMULATOR
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
 #include <string>
-#include <unordered_map>
 #include <vector>
+#include "guestMemory.h"
 
 using namespace std;
 
 #define NUM_OF_GPR    16
-#define NUM_OF_CSR    3
+#define NUM_OF_CSR    4
 
 #define PC_INIT       0x40000000
 #define pc            15
@@ -16,72 +22,332 @@ using namespace std;
 #define status        0
 #define handler       1
 #define cause         2
+#define coreid        3 // index of the core, set at reset
+
+// Free running counters, read only. One instruction is one cycle of the guest
+// clock (see CYCLES_PER_MS). The reading instruction hasn't retired yet, so
+// instret doesn't count it, while cycle counts its cycle too.
+#define CSR_INSTRET   4 // instructions retired before the reading one
+#define CSR_CYCLE     5 // guest clock cycles, including the current one
+#define CSR_SPACE     16 // csr indices an instruction can encode
 
 #define LOWER_4_BITS  0xF
 
-class Emulator {
+// ----------------------------------- PERIPHERALS --------------------------------
+
+#define MMIO_START        0xFFFFFF00
+#define TERM_OUT          0xFFFFFF00
+#define TERM_IN           0xFFFFFF04
+#define TIM_CFG           0xFFFFFF10
+
+#define TIMER_CAUSE       2
+#define TERMINAL_CAUSE    3
+#define SOFTWARE_CAUSE    4
+
+#define TIMER_MASK        0x1 // status bit masking timer interrupt
+#define TERMINAL_MASK     0x2 // status bit masking terminal interrupt
+#define INTERRUPT_MASK    0x4 // status bit masking all external interrupts
+
+#define CYCLES_PER_MS     10000 // nominal guest clock, one instruction is one cycle
+#define TERMINAL_DELAY    1000  // cycles between two received characters
+
+#define NEVER             ~0ULL
+
+// Scheduled peripheral event, the earliest one is on top of the heap
+struct Event {
+  unsigned long long cycle;
+  int type;
+  unsigned generation;
+
+  bool operator>(const Event &e) const { return cycle > e.cycle; }
+};
+
+#define TIMER_EVENT       0
+#define TERMINAL_EVENT    1
+#define SNAPSHOT_EVENT    2
+#define FORK_EVENT        3
+#define PROFILE_EVENT     4
+
+#define PROFILE_PERIOD    1009 // cycles between two profiler samples (prime, so loops don't alias)
+
+// Guest call frame seen by the profiler: stack slot holding the return
+// address and the address the frame was entered from
+struct ProfileFrame {
+  unsigned slot;
+  unsigned site;
+};
+
+class Machine;
+class TraceWriter;
+struct Instruction;
+
+typedef bool (Machine::*Handler)(const Instruction &);
+
+// Decoded instruction; execute is nullptr until the instruction is decoded
+struct Instruction {
+  Handler execute;
+  unsigned char op; // OC << 4 | M (see Machine::operation)
+  unsigned char OC;
+  unsigned char M;
+  unsigned char A;
+  unsigned char B;
+  unsigned char C;
+  int D;            // sign extended displacement
+};
+
+struct MicroOp;
+
+typedef bool (*MicroHandler)(Machine &, const MicroOp &);
+
+// Instruction translated for the block engine, operands are bound when the
+// block is translated. run returns false when execution must leave the block.
+struct MicroOp {
+  MicroHandler run;
+  unsigned char code; // OC << 4 | M of the guest instruction (for statistics)
+  unsigned char A;
+  unsigned char B;
+  unsigned char C;
+  int D;
+  unsigned next;    // address of the following instruction
+};
+
+#define MAX_BLOCK_SIZE  64
+
+// Straight-line guest code, ends with a control transfer, a write to pc or
+// a csr, at the page boundary or after MAX_BLOCK_SIZE instructions
+struct Block {
+  vector<MicroOp> ops;
+  unsigned start;
+  unsigned end;     // address following the block
+  bool valid;
+};
+
+// Decoded instructions and translated blocks of one guest page, one slot per
+// aligned word. Writing over a decoded instruction drops every block of the page.
+struct CodePage : CodeCache {
+  Instruction slots[GUEST_PAGE_SIZE / 4];
+  Block *blocks[GUEST_PAGE_SIZE / 4];
+  unsigned numOfBlocks;
+
+  // Invalidated blocks (one may still be running), freed by the block engine
+  // of the machine that owns the page
+  vector<Block *> &retired;
+
+  CodePage(vector<Block *> &retired) : slots(), blocks(), numOfBlocks(0), retired(retired) {}
+  ~CodePage();
+
+  void invalidate(unsigned offset) override;
+};
+
+// One emulated machine: processor state, guest memory and peripherals. A
+// running machine can be forked into children that share its memory pages
+// copy-on-write and run on their own threads.
+class Machine {
 public:
 
-  static void loadMemoryContent(string inputFileName);
+  Machine();
+
+  void loadMemoryContent(string inputFileName);
+  void loadImage(char *image, size_t size);
+
+  void init();
+
+  // Run the named engine (reference, threaded or block) until the processor stops
+  void run(const string &engine);
+
+  // forks
+  Machine *fork();
+  static void runMachines(const vector<Machine *> &, const string &engine);
+  void scheduleForks(unsigned long long cycle, const vector<string> &inputs);
+
+  // Cores of a machine with several processors, see emulatorCores.cpp
+  vector<Machine *> startCores(int numOfCores);
 
-  static void init();
+  // Characters received by the terminal, delivered one at a time
+  void feed(const string &characters);
 
-  static bool fetchInstruction();
+  unsigned getRegister(int) const;
+  void setRegister(int, unsigned);
+
+  // Terminal output of a forked machine, which doesn't write to cout
+  string terminalOutput() const;
+
+  // statistics
+  void collectStats();
+  void printStats();
+
+  // profiler, see emulatorProfile.cpp
+  void profile(string fileName, string mapFileName);
+  void profileCall(bool interrupted);
+  void profileSample();
+  void writeProfile();
+
+  // execution trace, see emulatorTrace.cpp
+  void trace(string fileName);
+  void runTraced();
+  void traceInterrupt();
+
+  // snapshots
+  void scheduleSnapshot(unsigned long long cycle, string fileName);
+  void saveSnapshot();
+  void restoreSnapshot(string fileName);
+
+  bool fetchInstruction();
+
+  // engines
+  void runReference();
+  void runThreaded();
+  void runBlocks();
+
+  Block *block(unsigned address);
+  Block *translate(unsigned address);
+  static MicroOp microOp(const Instruction &);
+  static bool endsBlock(const Instruction &);
+  static bool readsPC(const Instruction &);
+
+  const Instruction *decode(unsigned address);
+  const Instruction *decodeSlow(unsigned address);
+  static void decodeInstruction(Instruction &, unsigned);
+  static unsigned char operation(unsigned char, unsigned char);
+  void invalidPC();
+  unsigned readCounter(unsigned);
 
   // instructions
-  static bool _halt();
-  static void _int();
-  
-  static void _call();
+  bool _halt(const Instruction &);
+  bool _int(const Instruction &);
 
-  static void _jmp();
+  bool _call(const Instruction &);
 
-  static void _xchg();
+  bool _jmp(const Instruction &);
 
-  static void _ari();
+  bool _xchg(const Instruction &);
 
-  static void _log();
-  static void _not();
-  static void _and();
-  static void _or();
-  static void _xor();
+  bool _ari(const Instruction &);
 
-  static void _sh();
+  bool _log(const Instruction &);
 
-  static void _ld();
+  bool _sh(const Instruction &);
 
-  static void _st();
+  bool _ld(const Instruction &);
 
-  static bool wrongOC();
+  bool _st(const Instruction &);
 
+  bool wrongOC(const Instruction &);
 
-  static void printProcossorState();
+  // interrupts and peripherals
+  void interrupt(unsigned);
+  void startDevices();
+  static void deviceWrite(void *, unsigned, unsigned);
+  void serviceEvents();
+  void updateNextEvent();
+  bool deliverable();
+  void readTerminal();
+  static void restoreTerminal();
+
+
+  void printProcossorState();
 
 private:
 
-  static unordered_map<unsigned, char> memory;
+  GuestMemory memory;
+
+  vector<unsigned> gpr;
+  vector<unsigned> csr;
+
+  string message;
+
+  string snapshotFileName;
+
+  // Engine the machine runs, forks run the same one
+  string engine;
+  vector<string> forkInputs;
+
+  bool running;
+  Block *currentBlock;
+  vector<Block *> retired;  // see CodePage::retired
+
+  Instruction unaligned;    // decoded instruction on an unaligned address
 
-  static vector<unsigned> gpr;
-  static vector<unsigned> csr;
+  // Executed cycles and the cycle of the earliest event or deliverable interrupt.
+  // Engines compare the two before each instruction (or block) and call
+  // serviceEvents() only when an event is due.
+  unsigned long long cycles;
+  atomic<unsigned long long> nextEvent;
 
-  static string message;
+  priority_queue<Event, vector<Event>, greater<Event>> events;
+  unsigned timerGeneration;
+  bool terminalScheduled;
+  unsigned pending;          // bits are interrupt causes
 
-  static char OC;
-  static char M;
-  static char A;
-  static char B;
-  static char C;
-  static char D1;
-  static char D2_D3;
-  static int D;
+  // Filled by the stdin reader thread (or by whoever feeds a forked machine)
+  mutex inputMutex;
+  deque<char> input;
+  atomic<bool> inputReady;
 
-  static void push(int);
+  // Statistics are collected only when asked for, counters are indexed by
+  // OC << 4 | M and by interrupt cause
+  bool stats;
+  unsigned long long opCounts[256];
+  unsigned long long interruptCounts[8];
+  double runSeconds;
 
-  static char getByte(int, int);
-  static int fetchData(int);
-  static void insertData(int, int);
+  // Call stack rebuilt from calls and interrupts, samples are keyed by the
+  // addresses of the stack from the outermost frame to pc
+  bool profiling;
+  string profileFileName;
+  string mapFileName;
+  vector<ProfileFrame> callStack;
+  map<vector<unsigned>, unsigned long long> samples;
+
+  // Tracing machine notes the last memory write of an instruction and the
+  // cause of a taken interrupt for the record
+  TraceWriter *tracer;
+  bool traceWrite;
+  unsigned traceAddress;
+  unsigned traceValue;
+  unsigned char tracedInterrupt;
+
+  // Machine reads the host terminal (the first core, never a fork)
+  bool console;
+
+  // Forked machines write terminal output here instead of cout
+  bool forked;
+  string output;
+
+  void push(int);
+
+  int fetchData(int);
+  void insertData(int, int);
+
+  void startForks();
 };
 
+// Return decoded instruction on the address (nullptr if address is invalid)
+inline const Instruction *Machine::decode(unsigned address) {
+
+  GuestPage *p = memory.entry(address);
+
+  if (p && p->code && (address & 0x3) == 0) {
+    const Instruction &ins = static_cast<CodePage *>(p->code)->slots[(address & GUEST_PAGE_MASK) >> 2];
+    if (ins.execute) return &ins;
+  }
+
+  return decodeSlow(address);
+}
+
+// Return translated block starting on the address (nullptr if address is invalid)
+inline Block *Machine::block(unsigned address) {
+
+  GuestPage *p = memory.entry(address);
+
+  if (p && p->code && (address & 0x3) == 0) {
+    Block *b = static_cast<CodePage *>(p->code)->blocks[(address & GUEST_PAGE_MASK) >> 2];
+    if (b) return b;
+  }
+
+  return translate(address);
+}
+
 // -------------------------------- OPERATION CODES ------------------------------
 
 #define HALT      0x0
@@ -141,4 +407,10 @@ private:
 #define SHL       0x0 //  gpr[A]<=gpr[B] << gpr[C];  
 #define SHR       0x1 //  gpr[A]<=gpr[B] >> gpr[C];  
 
+// ------------------------------- DECODED OPERATIONS -----------------------------
+
+#define OP_COUNTER  0xFD  // csrrd of a counter csr
+#define OP_NOP      0xFE  // valid operation code with a mode that does nothing
+#define OP_INVALID  0xFF  // invalid operation code
+
 #endif //EMULATOR
\ No newline at end of file
@@ -0,0 +1,165 @@
+#if !defined(GUEST_MEMORY)
+#define GUEST_MEMORY
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Guest address space is split into 4 KiB pages which are reached through a
+// two level table (directory -> table -> page) and allocated on first touch
+
+#define GUEST_PAGE_BITS   12
+#define GUEST_PAGE_SIZE   (1 << GUEST_PAGE_BITS)
+#define GUEST_PAGE_MASK   (GUEST_PAGE_SIZE - 1)
+
+#define TABLE_BITS        10
+#define TABLE_SIZE        (1 << TABLE_BITS)
+#define TABLE_MASK        (TABLE_SIZE - 1)
+
+#define DIRECTORY_BITS    (32 - GUEST_PAGE_BITS - TABLE_BITS)
+#define DIRECTORY_SIZE    (1 << DIRECTORY_BITS)
+
+#define STORE_MISSES      64 // pages a view remembers the store didn't have
+
+// Anything the emulator derives from page content (e.g. decoded instructions).
+// Writes to a page with a code cache attached are reported to the cache.
+struct CodeCache {
+  virtual ~CodeCache() {}
+  virtual void invalidate(unsigned offset) = 0;
+};
+
+struct GuestPage {
+  char *data;
+  CodeCache *code;
+  bool device;      // page holds memory mapped registers
+  bool external;    // data is owned by someone else (e.g. a mapped image)
+
+  // Owners of data shared copy-on-write with forked memories (nullptr if the
+  // page is private). The page is copied before the first write.
+  std::atomic<unsigned> *references;
+
+  // Page is shared with memories used by other threads at the same time.
+  // Aligned words of such pages are read and written atomically, writes
+  // are sequentially consistent.
+  bool concurrent;
+};
+
+// Called after an aligned word was written to a memory mapped register
+typedef void (*DeviceWrite)(void *context, unsigned address, unsigned value);
+
+class GuestMemory {
+public:
+
+  GuestMemory();
+  ~GuestMemory();
+
+  // Page holding the address (nullptr if the page was never touched)
+  GuestPage *entry(unsigned address);
+  char *page(unsigned address);
+
+  // Private page holding the address (allocated or copied if needed)
+  GuestPage *touch(unsigned address);
+
+  // Use data as the page holding the address (false if the page is already in use)
+  bool attach(unsigned address, char *data);
+
+  unsigned read32(unsigned address);
+  void write32(unsigned address, unsigned value);
+
+  unsigned char read8(unsigned address);
+  void write8(unsigned address, unsigned char value);
+
+  unsigned pagesAllocated();
+
+  // Addresses of all pages in use, in ascending order
+  std::vector<unsigned> pages();
+
+  // Every page of this memory becomes a copy-on-write page of the empty child
+  void shareWith(GuestMemory &child);
+
+  // This empty memory becomes a view of the store: pages are taken from the
+  // store (and allocated there) on first touch, so every view sees the same
+  // data. Code caches stay with the view. Looking up a page the view doesn't
+  // have takes the store's lock, unless the view already found the page
+  // missing and no view added a page to the store since.
+  void viewOf(GuestMemory &store);
+
+  // Memory mapped registers take the addresses from start to the end of memory
+  void mapDevices(unsigned start, DeviceWrite, void *context);
+
+private:
+
+  GuestPage *directory[DIRECTORY_SIZE];
+  unsigned allocated;
+
+  unsigned deviceStart;
+  DeviceWrite deviceWrite;
+  void *deviceContext;
+
+  GuestMemory *store;     // memory this one is a view of (nullptr if none)
+  std::mutex storeMutex;  // taken by views when they use this memory as a store
+
+  // Pages views added to this memory, so a view knows its misses still hold
+  std::atomic<unsigned> storeGeneration;
+
+  // Pages missing in the store, by page number (valid while the store's
+  // generation is the same)
+  struct StoreMiss {
+    unsigned page;
+    unsigned generation;
+  };
+
+  StoreMiss storeMisses[STORE_MISSES];
+
+  GuestPage *fromStore(unsigned address, bool create);
+
+  void unshare(GuestPage *);
+  void release(GuestPage *);
+
+  unsigned readSlow(unsigned address);
+  void writeSlow(unsigned address, unsigned value);
+};
+
+// Guest is little endian like the host, so aligned words are copied as they are
+
+inline GuestPage *GuestMemory::entry(unsigned address) {
+  GuestPage *table = directory[address >> (GUEST_PAGE_BITS + TABLE_BITS)];
+
+  if (table) {
+    GuestPage *p = &table[(address >> GUEST_PAGE_BITS) & TABLE_MASK];
+    if (p->data) return p;
+  }
+
+  return store ? fromStore(address, false) : nullptr;
+}
+
+inline char *GuestMemory::page(unsigned address) {
+  GuestPage *p = entry(address);
+  return p ? p->data : nullptr;
+}
+
+inline unsigned GuestMemory::read32(unsigned address) {
+  GuestPage *p = entry(address);
+
+  if (p && !p->concurrent && (address & 0x3) == 0) {
+    unsigned value;
+    memcpy(&value, p->data + (address & GUEST_PAGE_MASK), sizeof(value));
+    return value;
+  }
+
+  return readSlow(address);
+}
+
+inline void GuestMemory::write32(unsigned address, unsigned value) {
+  GuestPage *p = entry(address);
+
+  if (p && !p->code && !p->device && !p->references && !p->concurrent && (address & 0x3) == 0) {
+    memcpy(p->data + (address & GUEST_PAGE_MASK), &value, sizeof(value));
+    return;
+  }
+
+  writeSlow(address, value);
+}
+
+#endif // GUEST_MEMORY
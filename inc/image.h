@@ -0,0 +1,32 @@
+#if !defined(IMAGE)
+#define IMAGE
+
+#include <cstdint>
+
+// Loadable image (linker's -bin output, emulator's input): header, segment
+// headers and raw segment bytes. Bytes of every segment start on a file
+// offset with the same position inside a 4 KiB page as its load address,
+// so whole pages can be mapped straight into guest memory. All values are
+// little endian.
+
+#define IMAGE_MAGIC     0x474D494D // "MIMG"
+#define IMAGE_VERSION   1
+#define IMAGE_PAGE_SIZE 4096
+
+struct ImageHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numOfSegments;
+  uint32_t reserved;
+};
+
+struct SegmentHeader
+{
+  uint32_t address; // load address
+  uint32_t size;
+  uint32_t offset;  // of segment bytes, from the beginning of file
+  uint32_t reserved;
+};
+
+#endif // IMAGE
@@ -2,6 +2,10 @@
 #define LINKER
 
 #include "myElf.h"
+#include "stageTimer.h"
+#include <functional>
+#include <map>
+#include <unordered_map>
 
 class Linker
 {
@@ -21,10 +25,15 @@ public:
 
   // Print output
   static void print(string);
+  static void printBinary(string);
+  static void printMap(string);
 
   // Clean
   static void cleanup();
 
+  // Workers
+  static void parallelFor(size_t, function<void(size_t)>);
+
   // Data structures
 
   struct PlaceSection
@@ -42,23 +51,56 @@ public:
     MyElf::Section *section;
     unsigned startAddr;
     unsigned endAddr;
-    Section *next;
-    Section *prev;
 
     Section(MyElf::Section *s, unsigned sa)
     {
       section = s;
       startAddr = sa;
+      endAddr = sa + s->size;
     }
   };
 
-  static Section *firstSection;
-  static Section *lastSection;
+  // Sections of all files with the same name, laid out one after another
+  // in command line order
+  struct Group
+  {
+    string name;
+    vector<MyElf::Section *> sections;
+    unsigned long long size;
+    unsigned startAddr;
+    bool placed;
+
+    Group(string n)
+    {
+      name = n;
+      size = 0;
+      startAddr = 0;
+      placed = false;
+    }
+  };
+
+  static vector<Group *> groups;                    // in order of first appearance
+  static unordered_map<string_view, Group *> groupIndex; // by name (in string pools of files)
+  static map<unsigned, Group *> placedGroups;       // groups with place option, by start address
+
+  // Placed sections in address order
+  static vector<Section> layout;
+
+  // Global symbol definitions of all files by name
+  struct GlobalSymbol
+  {
+    MyElf *myElf; // defining file
+    int value;
+  };
+
+  // Keyed by names in string pools of files, which live until cleanup
+  static unordered_map<string_view, GlobalSymbol> globalSymbols;
+
+  static StageTimer timer; // -time
 
   // Sextions helpers
 
-  static MyElf::Section *findSection(string name);
-  static bool putSection(Section *section);
+  static bool placeGroup(Group *group, unsigned address);
   static void updateSectionValue(Section *sec);
 };
 
@@ -1,31 +1,22 @@
 #if !defined(MYELF)
 #define MYELF
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <fstream>
+#include "stringPool.h"
 using namespace std;
 
 class MyElf
 {
 public:
 
+  // Records are stored by value and hold names as ids in the string pool, so
+  // every table is freed at once
   ~MyElf()
   {
-    for (Symbol *symbol : symbolTable)
-      delete symbol;
-
-    for (RelocationTable *rt : relocationTables)
-    {
-      for (Relocation *rel : rt->relocations)
-      {
-        delete rel;
-      }
-      delete rt;
-    }
-
-    for (Section *section : sections)
-      delete section;
+    unmap();
 
     outputFile.close();
   }
@@ -34,15 +25,15 @@ public:
 
   struct Symbol
   {
-    string name;
+    int nameId; // in names
     int value;
     bool isGlobal;
     bool isSection;
     int sectionId;
 
-    Symbol(string n, int v, bool isG, bool isS, int sId)
+    Symbol(int n, int v, bool isG, bool isS, int sId)
     {
-      name = n;
+      nameId = n;
       value = v;
       isGlobal = isG;
       isSection = isS;
@@ -50,7 +41,15 @@ public:
     }
   };
 
-  vector<Symbol *> symbolTable;
+  vector<Symbol> symbolTable;
+
+  // Names of symbols, sections and relocation tables (shared with assembler)
+  StringPool names;
+
+  // Place in symbol table by name id
+  NameIndex symbolIndex;
+
+  void addSymbol(const Symbol &);
 
   // ------------ Relocation tables ------------
 
@@ -79,38 +78,100 @@ public:
   struct RelocationTable
   {
     int sectionId;
-    string sectionName;
-    vector<Relocation *> relocations;
+    int sectionNameId; // in names
+    vector<Relocation> relocations;
 
-    RelocationTable(int sId, string sName)
+    RelocationTable(int sId, int sName)
     {
       sectionId = sId;
-      sectionName = sName;
+      sectionNameId = sName;
     }
   };
 
-  vector<RelocationTable *> relocationTables;
+  vector<RelocationTable> relocationTables;
 
   // ------------ Sections content ------------
 
   struct Section
   {
     int secId;
-    string sectionName;
+    int sectionNameId; // in names
     vector<char> memory;
     int size;
     vector<int> literalPool;
-    bool loaded;  // used by linker only
+    char *data;   // loaded content (memory of text object or mapped binary object)
     MyElf *myElf; // used by linker only
 
-    Section(int sId, string sName)
+    Section(int sId, int sName)
     {
       secId = sId;
-      sectionName = sName;
+      sectionNameId = sName;
+      size = 0;
+      data = nullptr;
+      myElf = nullptr;
     }
   };
 
-  vector<Section *> sections;
+  vector<Section> sections; // linker keeps pointers to sections once file is loaded
+
+  // ------------ Binary object format ------------
+
+  // Header, string table, symbol records, relocation table records, relocation
+  // records (grouped by table), section records and section contents.
+  // Every part starts on 8 byte boundary, all values are little endian.
+
+#define MYELF_MAGIC   0x464C454D // "MELF"
+#define MYELF_VERSION 1
+
+  struct FileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numOfSymbols;
+    uint32_t numOfRelocationTables;
+    uint32_t numOfRelocations;
+    uint32_t numOfSections;
+    uint32_t stringTableSize;
+    uint32_t reserved;
+  };
+
+  struct SymbolRecord
+  {
+    uint32_t name; // offset in string table
+    int32_t value;
+    int32_t sectionId;
+    uint8_t isGlobal;
+    uint8_t isSection;
+    uint16_t reserved;
+  };
+
+  struct RelocationTableRecord
+  {
+    int32_t sectionId;
+    uint32_t sectionName;
+    uint32_t numOfRelocations;
+    uint32_t reserved;
+  };
+
+  struct RelocationRecord
+  {
+    int32_t offset;
+    int32_t type;
+    int32_t symbolId;
+    int32_t addend;
+  };
+
+  struct SectionRecord
+  {
+    int32_t secId;
+    uint32_t sectionName;
+    uint32_t offset; // of content, from the beginning of file
+    uint32_t size;
+  };
+
+  // Binary objects are mapped privately, so linker patches section content in place
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
 
   ofstream outputFile;
 
@@ -122,8 +183,18 @@ public:
   
   void print();
 
+  void write();
+
+  vector<int> exportedSymbolIds();
+
+  void unmap();
+
+  static MyElf *load(string);
+
   static MyElf *read(FILE *);
 
+  static MyElf *readBinary(int);
+
   static void loadSymbolTable(FILE *, MyElf *);
 
   static void loadRelocationTables(FILE *, MyElf *);
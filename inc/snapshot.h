@@ -0,0 +1,38 @@
+#if !defined(SNAPSHOT)
+#define SNAPSHOT
+
+#include <cstdint>
+
+// Machine state saved by the emulator (--save) and resumed later (--restore):
+// header, scheduled events, unread terminal input, addresses of the saved
+// pages and page contents. Page contents start on a 4 KiB boundary of the
+// file, so the emulator maps them as guest pages and a page is read only
+// when the guest touches it. All values are little endian.
+
+#define SNAPSHOT_MAGIC      0x504E534D // "MSNP"
+#define SNAPSHOT_VERSION    2 // 2: all 16 csrs (version 1 had only the first 4)
+#define SNAPSHOT_PAGE_SIZE  4096
+
+struct SnapshotHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numOfPages;
+  uint32_t numOfEvents;
+  uint32_t inputSize;         // characters received but not delivered yet
+  uint32_t pending;           // interrupt causes waiting for delivery
+  uint32_t timerGeneration;
+  uint32_t terminalScheduled;
+  uint64_t cycles;
+  uint32_t gpr[16];
+  uint32_t csr[16];           // whole csr space, stores to unnamed csrs are kept too
+};
+
+struct SnapshotEvent
+{
+  uint64_t cycle;
+  uint32_t type;
+  uint32_t generation;
+};
+
+#endif // SNAPSHOT
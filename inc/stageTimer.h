@@ -0,0 +1,40 @@
+#if !defined(STAGE_TIMER)
+#define STAGE_TIMER
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+using namespace std;
+
+// Wall time of the stages of a tool run (assembler --time, linker -time).
+// Every finished stage prints one "stage <name> <seconds>" line.
+
+class StageTimer
+{
+public:
+  bool enabled = false;
+
+  void start()
+  {
+    stageStart = chrono::steady_clock::now();
+  }
+
+  // Ends the current stage and starts the next one
+  void done(const char *stage)
+  {
+    if (!enabled)
+      return;
+
+    auto now = chrono::steady_clock::now();
+    cout << "stage " << stage << ' ' << fixed << setprecision(6)
+         << chrono::duration<double>(now - stageStart).count() << endl;
+    cout.unsetf(ios::floatfield);
+
+    stageStart = now;
+  }
+
+private:
+  chrono::steady_clock::time_point stageStart = chrono::steady_clock::now();
+};
+
+#endif // STAGE_TIMER
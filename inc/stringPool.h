@@ -0,0 +1,143 @@
+#if !defined(STRING_POOL)
+#define STRING_POOL
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// Every distinct name is stored once and gets a dense id, so tables find
+// names by id instead of comparing strings. Names are kept null terminated in
+// large blocks and found through an open addressing table of ids, so a pool
+// of any size costs a few allocations.
+
+#define STRING_POOL_BLOCK 65536 // bytes of one block of names
+
+class StringPool
+{
+public:
+  // Id of the name (added to the pool if it is new)
+  int intern(string_view s)
+  {
+    if (2 * (starts.size() + 1) > slots.size())
+      grow();
+
+    size_t slot = lookup(s);
+    if (slots[slot] == -1)
+    {
+      slots[slot] = starts.size();
+      starts.push_back(store(s));
+      lengths.push_back(s.size());
+    }
+    return slots[slot];
+  }
+
+  // Id of the name (-1 if it was never interned)
+  int find(string_view s) const
+  {
+    return slots.empty() ? -1 : slots[lookup(s)];
+  }
+
+  // Name of the id, stays valid as long as the pool
+  string_view name(int id) const
+  {
+    return string_view(starts[id], lengths[id]);
+  }
+
+  int size() const
+  {
+    return starts.size();
+  }
+
+private:
+  vector<unique_ptr<char[]>> blocks;
+  char *block = nullptr;                 // block new names are added to
+  size_t blockUsed = STRING_POOL_BLOCK;
+
+  vector<const char *> starts; // by id
+  vector<uint32_t> lengths;
+  vector<int> slots;           // ids by hash of the name, -1 for free slots
+
+  static size_t hash(string_view s)
+  {
+    size_t h = 14695981039346656037ull; // FNV-1a
+    for (unsigned char c : s)
+      h = (h ^ c) * 1099511628211ull;
+    return h;
+  }
+
+  // Slot holding the name, or the free slot where it belongs
+  size_t lookup(string_view s) const
+  {
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash(s) & mask;; slot = (slot + 1) & mask)
+    {
+      int id = slots[slot];
+      if (id == -1 || name(id) == s)
+        return slot;
+    }
+  }
+
+  void grow()
+  {
+    slots.assign(slots.empty() ? 64 : 2 * slots.size(), -1);
+    for (int id = 0; id < (int)starts.size(); id++)
+      slots[lookup(name(id))] = id;
+  }
+
+  const char *store(string_view s)
+  {
+    size_t length = s.size() + 1;
+    char *start;
+
+    if (length > STRING_POOL_BLOCK)
+    {
+      // Longer names get a block of their own
+      blocks.emplace_back(new char[length]);
+      start = blocks.back().get();
+    }
+    else
+    {
+      if (length > STRING_POOL_BLOCK - blockUsed)
+      {
+        blocks.emplace_back(new char[STRING_POOL_BLOCK]);
+        block = blocks.back().get();
+        blockUsed = 0;
+      }
+
+      start = block + blockUsed;
+      blockUsed += length;
+    }
+
+    memcpy(start, s.data(), s.size());
+    start[s.size()] = '\0';
+    return start;
+  }
+};
+
+// Place of a name in some table, by name id (-1 if the name is not in the table)
+class NameIndex
+{
+public:
+  int find(int nameId) const
+  {
+    return nameId >= 0 && (size_t)nameId < positions.size() ? positions[nameId] : -1;
+  }
+
+  // First insertion of a name wins, like the first match of a linear search
+  void insert(int nameId, int position)
+  {
+    if ((size_t)nameId >= positions.size())
+      positions.resize(nameId + 1, -1);
+
+    if (positions[nameId] == -1)
+      positions[nameId] = position;
+  }
+
+private:
+  vector<int> positions;
+};
+
+#endif // STRING_POOL
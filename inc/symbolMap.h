@@ -0,0 +1,138 @@
+#if !defined(SYMBOL_MAP)
+#define SYMBOL_MAP
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Final layout of a linked program (linker's -map output): header, section
+// records sorted by start address, symbol records sorted by address and name,
+// string table. All values are little endian. The linker also writes the same
+// content as JSON next to the map (file.map.json).
+
+#define SYMBOL_MAP_MAGIC    0x50414D4D // "MMAP"
+#define SYMBOL_MAP_VERSION  2
+
+struct SymbolMapHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numOfSections;
+  uint32_t numOfSymbols;
+  uint32_t stringTableSize;
+};
+
+struct SectionMapRecord
+{
+  uint32_t start;
+  uint32_t end;  // address following the section
+  uint32_t name; // offset in the string table
+};
+
+struct SymbolMapRecord
+{
+  uint32_t address;
+  uint32_t name; // offset in the string table
+};
+
+// Address to section and symbol lookup for tools that read the map
+class SymbolMap
+{
+public:
+  struct Symbol
+  {
+    unsigned address;
+    string name;
+  };
+
+  struct Section
+  {
+    unsigned start;
+    unsigned end;
+    string name;
+  };
+
+  vector<Section> sections; // sorted by start address, none of them empty
+  vector<Symbol> symbols;   // sorted by address
+
+  bool load(const string &fileName)
+  {
+    ifstream file(fileName, ios::binary);
+    SymbolMapHeader header;
+
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.magic != SYMBOL_MAP_MAGIC || header.version != SYMBOL_MAP_VERSION)
+      return false;
+
+    vector<SectionMapRecord> sectionRecords(header.numOfSections);
+    vector<SymbolMapRecord> records(header.numOfSymbols);
+    string strings(header.stringTableSize, '\0');
+
+    if (!file.read(reinterpret_cast<char *>(sectionRecords.data()), sectionRecords.size() * sizeof(SectionMapRecord)) ||
+        !file.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(SymbolMapRecord)) ||
+        !file.read(&strings[0], strings.size()))
+      return false;
+
+    sections.clear();
+    for (const SectionMapRecord &record : sectionRecords)
+    {
+      if (record.name >= strings.size())
+        return false;
+      sections.push_back({record.start, record.end, strings.c_str() + record.name});
+    }
+
+    symbols.clear();
+    for (const SymbolMapRecord &record : records)
+    {
+      if (record.name >= strings.size())
+        return false;
+      symbols.push_back({record.address, strings.c_str() + record.name});
+    }
+
+    return true;
+  }
+
+  // Symbol with the highest address not above the address (nullptr if there is none)
+  const Symbol *find(unsigned address) const
+  {
+    auto it = upper_bound(symbols.begin(), symbols.end(), address,
+                          [](unsigned a, const Symbol &s) { return a < s.address; });
+    return it == symbols.begin() ? nullptr : &*(it - 1);
+  }
+
+  // Section holding the address (nullptr if there is none)
+  const Section *section(unsigned address) const
+  {
+    auto it = upper_bound(sections.begin(), sections.end(), address,
+                          [](unsigned a, const Section &s) { return a < s.start; });
+    if (it == sections.begin() || address >= (it - 1)->end)
+      return nullptr;
+    return &*(it - 1);
+  }
+
+  // Symbol holding the address: the nearest one below it in the same section
+  // (nullptr if there is none)
+  const Symbol *symbolAt(unsigned address) const
+  {
+    const Symbol *symbol = find(address);
+    const Section *s = section(address);
+    return symbol && s && symbol->address >= s->start ? symbol : nullptr;
+  }
+
+  // Name of the symbol holding the address, hex address if there is none
+  string name(unsigned address) const
+  {
+    if (const Symbol *symbol = symbolAt(address))
+      return symbol->name;
+
+    stringstream ss;
+    ss << "0x" << hex << address;
+    return ss.str();
+  }
+};
+
+#endif // SYMBOL_MAP
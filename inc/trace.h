@@ -0,0 +1,215 @@
+#if !defined(TRACE)
+#define TRACE
+
+#include <cstdint>
+using namespace std;
+
+// Execution trace written by the emulator (--trace) and printed by the
+// decoder: header followed by one encoded record per executed instruction or
+// taken interrupt. Records are delta encoded against the state the decoder
+// rebuilds from earlier records, so a straight-line instruction seen before
+// costs a few bytes. All values are little endian.
+//
+// Record: flags byte, then
+//   pc       zigzag varint of pc - expected pc   (unless TRACE_SEQUENTIAL)
+//   raw      4 bytes                             (unless TRACE_RAW_KNOWN)
+//   cause    1 byte                              (TRACE_INTERRUPT only)
+//   regs     for each of TRACE_REGS(flags) changed registers a byte with the
+//            index in the low and the zigzag delta of the value in the high
+//            nibble; delta 15 and above is 15 followed by varint of delta - 15
+//   write    zigzag varint of address - previous address, varint of value
+//            (TRACE_WRITE only)
+
+#define TRACE_MAGIC     0x4352544D // "MTRC"
+#define TRACE_VERSION   1
+
+#define TRACE_INTERRUPT   0x01 // interrupt taken, pc is the handler
+#define TRACE_SEQUENTIAL  0x02 // pc follows the previous instruction
+#define TRACE_RAW_KNOWN   0x04 // same instruction word as last time on this pc
+#define TRACE_WRITE       0x08 // instruction wrote a memory word
+#define TRACE_REGS_SHIFT  4    // number of changed registers (0 to 2)
+#define TRACE_REGS(flags) (((flags) >> TRACE_REGS_SHIFT) & 0x3)
+
+#define TRACE_MAX_REGS    2  // xchg and pop with post increment change two
+#define TRACE_MAX_RECORD  64 // encoded bytes of one record at most
+
+#define TRACE_RAW_CACHE   4096 // instruction words remembered, by pc
+
+struct TraceHeader
+{
+  uint32_t magic;
+  uint32_t version;
+};
+
+// One executed instruction (or interrupt) as the emulator records it
+struct TraceRecord
+{
+  uint32_t address;    // of the instruction, of the handler for interrupts
+  uint32_t raw;        // instruction word, lowest byte first
+  uint8_t interrupt;   // cause of a taken interrupt, 0 for instructions
+  uint8_t numOfRegs;
+  uint8_t write;       // writeAddress and writeValue are valid
+  uint8_t regs[TRACE_MAX_REGS];
+  uint32_t values[TRACE_MAX_REGS];
+  uint32_t writeAddress;
+  uint32_t writeValue;
+};
+
+// State shared by the encoder and the decoder. Instruction words are kept in
+// a direct mapped cache, both sides replace entries the same way.
+struct TraceState
+{
+  uint32_t nextPC = 0;
+  uint32_t lastWrite = 0;
+  uint32_t regs[16] = {};
+
+  struct RawEntry
+  {
+    uint32_t address;
+    uint32_t raw;
+    bool valid;
+  } raws[TRACE_RAW_CACHE] = {};
+
+  RawEntry &raw(uint32_t address) { return raws[(address >> 2) & (TRACE_RAW_CACHE - 1)]; }
+};
+
+inline uint64_t traceZigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t traceUnzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+inline uint8_t *traceVarint(uint8_t *out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    *out++ = value | 0x80;
+    value >>= 7;
+  }
+  *out++ = value;
+  return out;
+}
+
+// Reads a varint, in is left past end when the record is cut short
+inline uint64_t traceReadVarint(const uint8_t *&in, const uint8_t *end)
+{
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    uint8_t b = in < end ? *in : 0;
+    in++;
+    value |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      break;
+  }
+  return value;
+}
+
+// Writes the record (TRACE_MAX_RECORD bytes at most), returns the end of it
+inline uint8_t *traceEncode(uint8_t *out, TraceState &state, const TraceRecord &record)
+{
+  TraceState::RawEntry &raw = state.raw(record.address);
+
+  uint8_t flags = record.numOfRegs << TRACE_REGS_SHIFT;
+  if (record.interrupt) flags |= TRACE_INTERRUPT;
+  if (record.address == state.nextPC) flags |= TRACE_SEQUENTIAL;
+  if (record.write) flags |= TRACE_WRITE;
+  if (record.interrupt || (raw.valid && raw.address == record.address && raw.raw == record.raw)) flags |= TRACE_RAW_KNOWN;
+
+  *out++ = flags;
+
+  if (!(flags & TRACE_SEQUENTIAL))
+    out = traceVarint(out, traceZigzag((int64_t)record.address - state.nextPC));
+
+  if (!(flags & TRACE_RAW_KNOWN))
+  {
+    for (int i = 0; i < 4; i++) *out++ = record.raw >> (8 * i);
+    raw = {record.address, record.raw, true};
+  }
+
+  if (record.interrupt)
+    *out++ = record.interrupt;
+
+  for (int i = 0; i < record.numOfRegs; i++)
+  {
+    uint8_t index = record.regs[i] & 0xF;
+    uint64_t delta = traceZigzag((int64_t)record.values[i] - state.regs[index]);
+
+    if (delta < 15)
+      *out++ = index | delta << 4;
+    else
+    {
+      *out++ = index | 0xF0;
+      out = traceVarint(out, delta - 15);
+    }
+    state.regs[index] = record.values[i];
+  }
+
+  if (record.write)
+  {
+    out = traceVarint(out, traceZigzag((int64_t)record.writeAddress - state.lastWrite));
+    out = traceVarint(out, record.writeValue);
+    state.lastWrite = record.writeAddress;
+  }
+
+  // Interrupt continues on the handler, an instruction on the following word
+  state.nextPC = record.interrupt ? record.address : record.address + 4;
+
+  return out;
+}
+
+// Reads a record, returns false if the trace ends inside it
+inline bool traceDecode(const uint8_t *&in, const uint8_t *end, TraceState &state, TraceRecord &record)
+{
+  uint8_t flags = in < end ? *in : 0;
+  in++;
+
+  record.interrupt = 0;
+  record.numOfRegs = TRACE_REGS(flags);
+  record.write = (flags & TRACE_WRITE) != 0;
+
+  record.address = flags & TRACE_SEQUENTIAL ? state.nextPC : state.nextPC + traceUnzigzag(traceReadVarint(in, end));
+
+  TraceState::RawEntry &raw = state.raw(record.address);
+
+  if (flags & TRACE_INTERRUPT)
+    record.raw = 0;
+  else if (flags & TRACE_RAW_KNOWN)
+    record.raw = raw.raw;
+  else
+  {
+    record.raw = 0;
+    for (int i = 0; i < 4; i++, in++) record.raw |= (uint32_t)(in < end ? *in : 0) << (8 * i);
+    raw = {record.address, record.raw, true};
+  }
+
+  if (flags & TRACE_INTERRUPT)
+  {
+    record.interrupt = in < end ? *in : 0;
+    in++;
+  }
+
+  for (int i = 0; i < record.numOfRegs; i++)
+  {
+    uint8_t b = in < end ? *in : 0;
+    in++;
+
+    uint64_t delta = b >> 4;
+    if (delta == 15)
+      delta += traceReadVarint(in, end);
+
+    record.regs[i] = b & 0xF;
+    record.values[i] = state.regs[record.regs[i]] + traceUnzigzag(delta);
+    state.regs[record.regs[i]] = record.values[i];
+  }
+
+  if (record.write)
+  {
+    record.writeAddress = state.lastWrite + traceUnzigzag(traceReadVarint(in, end));
+    record.writeValue = traceReadVarint(in, end);
+    state.lastWrite = record.writeAddress;
+  }
+
+  state.nextPC = record.interrupt ? record.address : record.address + 4;
+
+  return in <= end;
+}
+
+#endif // TRACE
@@ -24,7 +24,7 @@
 %token CSRRD CSRWR                                      // control status register instructions
 %token EOL                                              // end of line
 %token <ival> GPR                                       // general purpose registers (r0 - r15)
-%token <ival> CSR                                       // control and status registers (status, handler, cause)
+%token <ival> CSR                                       // control and status registers (status, handler, cause, coreid, instret, cycle)
 %token <ival> NUM                                       // integer number
 %token <sval> SYM                                       // symbol (string)
 
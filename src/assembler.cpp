@@ -77,20 +77,25 @@ const int D_MIN = -(1 << D_SIZE - 1);
 // -------------------------------- STATIC VARIABLES ------------------------------
 
 unsigned Assembler::locationCounter = 0;
-bool Assembler::first = true;
 int Assembler::currSecId = 0;
 string Assembler::currSecName = "";
 vector<Assembler::Symbol *> Assembler::symbolTable;
 vector<Assembler::Section *> Assembler::sectionTable;
+NameIndex Assembler::symbolIndex;
+NameIndex Assembler::sectionIndex;
+vector<Assembler::PoolFixup> Assembler::poolFixups;
+vector<Assembler::SymbolFixup> Assembler::symbolFixups;
 FILE *Assembler::asmFile;
+bool Assembler::textOutput = false;
+StageTimer Assembler::timer;
 MyElf *Assembler::myElf = new MyElf();
 
 // -------------------------------- HELPER FUNCTIONS ------------------------------
 
 void Assembler::init()
 {
-  sectionTable.push_back(new Section("UND"));
-  myElf->sections.push_back(new MyElf::Section(0, "UND"));
+  addSection(new Section("UND"));
+  myElf->sections.emplace_back(0, myElf->names.intern("UND"));
 }
 
 
@@ -99,69 +104,140 @@ void Assembler::createMyElfSymbolTable()
   // Insert sections into symbol table
   for (int i = 0; i < sectionTable.size(); i++)
   {
-    myElf->symbolTable.push_back(new MyElf::Symbol(sectionTable[i]->name, 0, false, true, i));
+    myElf->addSymbol(MyElf::Symbol(myElf->names.intern(sectionTable[i]->name), 0, false, true, i));
   }
 
   // Insert symbols into symbol table
   for (Symbol *s : symbolTable)
   {
-    myElf->symbolTable.push_back(new MyElf::Symbol(s->name, s->value, s->global, false, s->sectionId));
+    myElf->addSymbol(MyElf::Symbol(myElf->names.intern(s->name), s->value, s->global, false, s->sectionId));
   }
 }
 
 
 void Assembler::setGlobal(char *symbol)
 {
-  int i = 0;
-  for (; i < symbolTable.size(); i++)
+  int i = findSymbol(symbol);
+
+  if (i != -1)
+    symbolTable[i]->global = true;
+  else
+    addSymbol(new Symbol(symbol, 0, true, 0));
+}
+
+
+// Symbol and section tables are indexed by ids of names interned in myElf's pool
+
+int Assembler::findSymbol(char *name)
+{
+  return symbolIndex.find(myElf->names.find(name));
+}
+
+
+int Assembler::findSection(char *name)
+{
+  return sectionIndex.find(myElf->names.find(name));
+}
+
+
+void Assembler::addSymbol(Symbol *symbol)
+{
+  symbolIndex.insert(myElf->names.intern(symbol->name), symbolTable.size());
+  symbolTable.push_back(symbol);
+}
+
+
+void Assembler::addSection(Section *section)
+{
+  sectionIndex.insert(myElf->names.intern(section->name), sectionTable.size());
+  sectionTable.push_back(section);
+}
+
+
+// Relocation is created at the end of file, when it is known whether symbol is local or global
+void Assembler::newRelocation(int offset, char *symbol, MyElf::RelocationTypes type, int addend)
+{
+  symbolFixups.push_back(SymbolFixup(currSecId, offset, -1, symbol, type, addend));
+}
+
+
+void Assembler::resolveFixups()
+{
+  for (SymbolFixup &fixup : symbolFixups)
   {
-    if (symbolTable[i]->name == symbol)
+    MyElf::Section *section = &myElf->sections[fixup.secId];
+
+    // Literal pool follows the instruction that jumps over it
+    int offset = fixup.poolIndex == -1 ? fixup.offset : section->size + INSTR_SIZE + fixup.poolIndex * 4;
+
+    // Find symbol in symbol table
+    int symId = myElf->symbolId((char *)fixup.symbol.c_str());
+
+    // If symbol doesn't exist, report error and exit
+    if (symId == -1)
     {
-      symbolTable[i]->global = true;
-      break;
+      cout << "Symbol " << fixup.symbol << " (used on byte " << fixup.offset << " of section " << fixup.secId
+           << ") is not declared in this file!" << endl;
+      exit(-2);
     }
+
+    int addend = fixup.addend;
+
+    // If symbol is local (linker won't see it)
+    if (!myElf->symbolTable[symId].isGlobal) {
+      addend += myElf->symbolTable[symId].value;
+      symId = myElf->symbolTable[symId].sectionId;
+    }
+
+    // Find section's relocation table place
+    int p = myElf->secRelTabId(fixup.secId);
+
+    // If section doesn't have relocation table, create it
+    if (p == -1)
+    {
+      myElf->relocationTables.emplace_back(fixup.secId, section->sectionNameId);
+      p = myElf->relocationTables.size() - 1;
+    }
+
+    // Insert new relocation into relocation table for section
+    myElf->relocationTables[p].relocations.emplace_back(offset, fixup.type, symId, addend);
   }
 
-  if (i == symbolTable.size())
-    symbolTable.push_back(new Symbol(symbol, 0, true, 0));
+  symbolFixups.clear();
 }
 
 
-void Assembler::newRelocation(int offset, char *symbol, MyElf::RelocationTypes type, int addend)
+// Size of the section is known when it is closed, so literal pool displacements are filled in here
+void Assembler::closeSection()
 {
-  // Find symbol in symbol table
-  int symId = myElf->symbolId(symbol);
+  if (currSecId == 0)
+    return;
+
+  MyElf::Section *section = &myElf->sections[currSecId];
 
-  // If symbol doesn't exist, report error and exit
-  if (symId == -1)
+  sectionTable[currSecId]->size = locationCounter;
+  section->size = locationCounter;
+
+  for (PoolFixup &fixup : poolFixups)
   {
-    cout << "Symbol " << symbol << " (used on byte " << locationCounter << " of section " << currSecId
-         << ") is not declared in this file!" << endl;
-    exit(-2);
-  }
+    int offset = section->size - fixup.offset // gap to the end of section
+                 + fixup.poolIndex * 4         // offset in literal pool array
+                 - INSTR_SIZE                  // because pc is pointing to the next instruction
+                 + INSTR_SIZE;                 // because we will add another instruction (to avoid literal pool) at the end of the section
 
-  // If symbol is local (linker won't see it)
-  if (!myElf->symbolTable[symId]->isGlobal) {
-    addend += myElf->symbolTable[symId]->value;
-    symId = myElf->symbolTable[symId]->sectionId;
+    section->memory[fixup.offset + 2] = (section->memory[fixup.offset + 2] & 0xF0) | (getByte(offset, 1) & 0x0F);
+    section->memory[fixup.offset + 3] = getByte(offset, 0);
   }
 
-  // Find current section's relocation table place
-  int p = myElf->secRelTabId(currSecId);
+  poolFixups.clear();
 
-  // If section doesn't have relocation table, create it
-  if (p == -1)
+  // If section used literal pool,
+  // we need to insert pc <= pc + literealPool.size() * sizeof(int) instruction
+  int litPoolSize = section->literalPool.size() * sizeof(int);
+  if (litPoolSize > 0)
   {
-    MyElf::RelocationTable *relocationTable = new MyElf::RelocationTable(currSecId, currSecName);
-    myElf->relocationTables.push_back(relocationTable);
-    p = myElf->relocationTables.size() - 1;
+    codeInstruction((JMP_OC << 4) | JMP_M1, PC << 4, getByte(litPoolSize, 1) & 0x0F, getByte(litPoolSize, 0));
   }
-
-  // Create new relocation
-  MyElf::Relocation *relocation = new MyElf::Relocation(offset, type, symId, addend);
-
-  // Insert relocation into relocation table for current section
-  myElf->relocationTables[p]->relocations.push_back(relocation);
 }
 
 
@@ -173,10 +249,10 @@ char Assembler::getByte(int value, int byteIndex)
 
 void Assembler::codeInstruction(char byte1, char byte2, char byte3, char byte4)
 {
-  myElf->sections[currSecId]->memory.push_back(byte1);
-  myElf->sections[currSecId]->memory.push_back(byte2);
-  myElf->sections[currSecId]->memory.push_back(byte3);
-  myElf->sections[currSecId]->memory.push_back(byte4);
+  myElf->sections[currSecId].memory.push_back(byte1);
+  myElf->sections[currSecId].memory.push_back(byte2);
+  myElf->sections[currSecId].memory.push_back(byte3);
+  myElf->sections[currSecId].memory.push_back(byte4);
   locationCounter += INSTR_SIZE;
 }
 
@@ -191,14 +267,12 @@ void Assembler::literalPoolProcessing(char OC, char M1, char M2, char A1, char A
   else
   {
     // Literal can't fit in insturction, we must put it in literal pool
-    myElf->sections[currSecId]->literalPool.push_back(D);
+    myElf->sections[currSecId].literalPool.push_back(D);
 
-    int offset = myElf->sections[currSecId]->size - locationCounter         // gap to the end of section*
-                 + (myElf->sections[currSecId]->literalPool.size() - 1) * 4 // offset in literal pool array
-                 - INSTR_SIZE                                               // because pc is pointing to the next instruction
-                 + INSTR_SIZE;                                              // because we will add another instruction (to avoid literal pool) at the end of the section
+    // Displacement to the literal is filled in when the section is closed
+    poolFixups.push_back({locationCounter, (int)myElf->sections[currSecId].literalPool.size() - 1});
 
-    codeInstruction((OC << 4) | M2, (A2 << 4) | B, (C << 4) | (getByte(offset, 1) & 0x0F), getByte(offset, 0));
+    codeInstruction((OC << 4) | M2, (A2 << 4) | B, C << 4, 0);
   }
 }
 
@@ -206,18 +280,14 @@ void Assembler::literalPoolProcessing(char OC, char M1, char M2, char A1, char A
 void Assembler::literalPoolProcessing(char OC, char M, char A, char B, char C, char *D)
 {
   // We need to "put" symbol in literal pool and create new relocation for it
-  myElf->sections[currSecId]->literalPool.push_back(0);
+  myElf->sections[currSecId].literalPool.push_back(0);
 
-  int offset = myElf->sections[currSecId]->size - locationCounter         // gap to the end of section*
-               + (myElf->sections[currSecId]->literalPool.size() - 1) * 4 // offset in literal pool array
-               - INSTR_SIZE                                               // because pc is pointing to the next instruction
-               + INSTR_SIZE;                                              // because we will add another instruction (to avoid literal pool) at the end of the section
+  int poolIndex = myElf->sections[currSecId].literalPool.size() - 1;
 
-  codeInstruction((OC << 4) | M, A << 4 | B, (C << 4) | (getByte(offset, 1) & 0x0F), getByte(offset, 0));
+  poolFixups.push_back({locationCounter, poolIndex});
+  symbolFixups.push_back(SymbolFixup(currSecId, locationCounter, poolIndex, D, MyElf::ABSOLUTE, 0));
 
-  // Relocation
-  int relTabOffset = myElf->sections[currSecId]->size + INSTR_SIZE + (myElf->sections[currSecId]->literalPool.size() - 1) * 4;
-  newRelocation(relTabOffset, D, MyElf::ABSOLUTE, 0);
+  codeInstruction((OC << 4) | M, A << 4 | B, C << 4, 0);
 }
 
 
@@ -236,175 +306,105 @@ void Assembler::cleanup()
 
 void Assembler::_global(char *symbol)
 {
-  if (first)
-  {
-    setGlobal(symbol);
-  }
+  setGlobal(symbol);
 }
 
 
 void Assembler::_extern(char *symbol)
 {
-  if (first)
-  {
-    setGlobal(symbol);
-  }
+  setGlobal(symbol);
 }
 
 
 void Assembler::_section(char *symbol)
 {
-  if (first)
-  {
-    if (currSecId != 0)
-    {
-      sectionTable[currSecId]->size = locationCounter;
-      myElf->sections[currSecId]->size = locationCounter;
-    }
+  closeSection();
 
-    locationCounter = 0;
-    currSecId = sectionTable.size();
-    currSecName = symbol;
-    sectionTable.push_back(new Section(symbol));
-    myElf->sections.push_back(new MyElf::Section(currSecId, symbol));
-  }
-  else
-  {
-    // If previous section used literal pool,
-    // we need to insert pc <= pc + literealPool.size() * sizeof(int) instruction
-    int litPoolSize = myElf->sections[currSecId]->literalPool.size() * sizeof(int);
-    if (litPoolSize > 0)
-    {
-      codeInstruction((JMP_OC << 4) | JMP_M1, PC << 4, getByte(litPoolSize, 1) & 0x0F, getByte(litPoolSize, 0));
-    }
-
-    locationCounter = 0;
-    for (int i = 0; i < sectionTable.size(); i++)
-
-      if (sectionTable[i]->name == symbol)
-      {
-        currSecId = i;
-        break;
-      }
-    currSecName = symbol;
-  }
+  locationCounter = 0;
+  currSecId = sectionTable.size();
+  currSecName = symbol;
+  addSection(new Section(symbol));
+  myElf->sections.emplace_back(currSecId, myElf->names.intern(symbol));
 }
 
 
 void Assembler::_word(char *symbol)
 {
-  if (first)
+  newRelocation(locationCounter, symbol, MyElf::ABSOLUTE, 0);
+
+  for (int i = 0; i < 4; i++)
   {
-    locationCounter += 4;
+    myElf->sections[currSecId].memory.push_back(0);
   }
-  else
-  {
-    newRelocation(locationCounter, symbol, MyElf::ABSOLUTE, 0);
 
-    for (int i = 0; i < 4; i++)
-    {
-      myElf->sections[currSecId]->memory.push_back(0);
-    }
-
-    locationCounter += 4;
-  }
+  locationCounter += 4;
 }
 
 
 void Assembler::_word(int literal)
 {
-  if (first)
+  for (int i = 0; i < 4; i++)
   {
-    locationCounter += 4;
+    myElf->sections[currSecId].memory.push_back(getByte(literal, i));
   }
-  else
-  {
-    for (int i = 0; i < 4; i++)
-    {
-      myElf->sections[currSecId]->memory.push_back(getByte(literal, i));
-    }
 
-    locationCounter += 4;
-  }
+  locationCounter += 4;
 }
 
 
 void Assembler::_skip(int literal)
 {
-  if (first)
+  for (int i = 0; i < literal; i++)
   {
-    locationCounter += literal;
-  }
-  else
-  {
-    for (int i = 0; i < literal; i++)
-    {
-      myElf->sections[currSecId]->memory.push_back(0);
-    }
-    locationCounter += literal;
+    myElf->sections[currSecId].memory.push_back(0);
   }
+  locationCounter += literal;
 }
 
 
 void Assembler::_end()
 {
-  if (first)
-  {
-    if (currSecId != 0)
-    {
-      sectionTable[currSecId]->size = locationCounter;
-      myElf->sections[currSecId]->size = locationCounter;
-    }
+  closeSection();
+  timer.done("parse");
 
-    first = false;
-    locationCounter = 0;
-    createMyElfSymbolTable();
-  }
-  else
-  {
-    // If previous section used literal pool,
-    // we need to insert pc <= pc + literealPool.size() * sizeof(int) instruction
-    int litPoolSize = myElf->sections[currSecId]->literalPool.size() * sizeof(int);
-    if (litPoolSize > 0)
-    {
-      codeInstruction((JMP_OC << 4) | JMP_M1, PC << 4, getByte(litPoolSize, 1) & 0x0F, getByte(litPoolSize, 0));
-    }
+  // All symbols are known now
+  createMyElfSymbolTable();
+  timer.done("symbols");
 
+  resolveFixups();
+  timer.done("relocations");
+
+  if (textOutput)
     myElf->print();
-    // cout << "File assembled successfuly!" << endl;
-    exit(0);
-  }
+  else
+    myElf->write();
+  myElf->outputFile.flush();
+  timer.done("print");
+  // cout << "File assembled successfuly!" << endl;
+  exit(0);
 }
 
 // -------------------------------------- LABEL --------------------------------------
 
 void Assembler::_label(char *symbol)
 {
-  if (first)
-  {
+  int i = findSymbol(symbol);
 
-    int i = 0;
-    for (; i < symbolTable.size(); i++)
+  if (i != -1)
+  {
+    if (symbolTable[i]->sectionId != 0)
     {
-      if (symbolTable[i]->name == symbol)
-      {
-        if (symbolTable[i]->sectionId != 0)
-        {
-          cout << "Symbol " << symbol << " already defined here: section "
-               << sectionTable[symbolTable[i]->sectionId]->name << ", byte " << symbolTable[i]->value << endl;
-          exit(-1);
-        }
-
-        symbolTable[i]->sectionId = currSecId;
-        symbolTable[i]->value = locationCounter;
-        break;
-      }
+      cout << "Symbol " << symbol << " already defined here: section "
+           << sectionTable[symbolTable[i]->sectionId]->name << ", byte " << symbolTable[i]->value << endl;
+      exit(-1);
     }
 
-    if (i == symbolTable.size())
-    {
-      symbolTable.push_back(new Symbol(symbol, locationCounter, false, currSecId));
-    }
+    symbolTable[i]->sectionId = currSecId;
+    symbolTable[i]->value = locationCounter;
+  }
+  else
+  {
+    addSymbol(new Symbol(symbol, locationCounter, false, currSecId));
   }
 }
 
@@ -412,511 +412,266 @@ void Assembler::_label(char *symbol)
 
 void Assembler::_halt()
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    // 0b0000 0000 0000 0000 0000 0000 0000 0000
-    codeInstruction(HALT_OC << 4, 0, 0, 0);
-  }
+  // 0b0000 0000 0000 0000 0000 0000 0000 0000
+  codeInstruction(HALT_OC << 4, 0, 0, 0);
 }
 
 
 void Assembler::_int()
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    // 0b0001 0000 0000 0000 0000 0000 0000 0000
-    codeInstruction(INT_OC << 4, 0, 0, 0);
-  }
+  // 0b0001 0000 0000 0000 0000 0000 0000 0000
+  codeInstruction(INT_OC << 4, 0, 0, 0);
 }
 
 
 void Assembler::_iret()
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE * 3; // Because it is pseudo instruction (translates to three instructions)
-  }
-  else
-  {
-    // Pseudo instruction, transletes to: pop pc; pop status;
-    // But, if we pop into pc, pop status will never happen (because pc will be somewhere else)
-    // Instead we need to resolve it into three instructions:
+  // Pseudo instruction, transletes to: pop pc; pop status;
+  // But, if we pop into pc, pop status will never happen (because pc will be somewhere else)
+  // Instead we need to resolve it into three instructions:
 
-    // 1. gprA = gprB + D (gprA = gprB = SP, D = 8)
-    codeInstruction((LD_OC << 4) | LD_GPR_M2, (SP << 4) | SP, getByte(8, 1) & 0x0F, getByte(8, 0));
+  // 1. gprA = gprB + D (gprA = gprB = SP, D = 8)
+  codeInstruction((LD_OC << 4) | LD_GPR_M2, (SP << 4) | SP, getByte(8, 1) & 0x0F, getByte(8, 0));
 
-    // 2. csrA = mem [gprB + gprC + D] (csrA = status, gprB = SP, D = -4)
-    codeInstruction((LD_OC << 4) | LD_CSR_M3, (STATUS << 4) | SP, getByte(-4, 1) & 0x0F, getByte(-4, 0));
+  // 2. csrA = mem [gprB + gprC + D] (csrA = status, gprB = SP, D = -4)
+  codeInstruction((LD_OC << 4) | LD_CSR_M3, (STATUS << 4) | SP, getByte(-4, 1) & 0x0F, getByte(-4, 0));
 
-    // 3. gprA = mem[gprB + gprC + D] (gprA = PC, gprB = SP, D = -8)
-    codeInstruction((LD_OC << 4) | LD_GPR_M3, (PC << 4) | SP, getByte(-8, 1) & 0x0F, getByte(-8, 0));
-  }
+  // 3. gprA = mem[gprB + gprC + D] (gprA = PC, gprB = SP, D = -8)
+  codeInstruction((LD_OC << 4) | LD_GPR_M3, (PC << 4) | SP, getByte(-8, 1) & 0x0F, getByte(-8, 0));
 }
 
 
 void Assembler::_ret()
 {
   // Pseudo instruction, transletes to: pop pc;
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    // pop pc; We can use defined _pop(int) function because pc is gpr register
-    _pop(PC);
-  }
+  // pop pc; We can use defined _pop(int) function because pc is gpr register
+  _pop(PC);
 }
 
 // ------------------------------ CALL/JUMP INSTRUCTIONS ------------------------------
 
 void Assembler::_call(int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(CALL_OC, CALL_M1, CALL_M2, 0, PC, 0, 0, literal);
-  }
+  literalPoolProcessing(CALL_OC, CALL_M1, CALL_M2, 0, PC, 0, 0, literal);
 }
 
 
 void Assembler::_call(char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(CALL_OC, CALL_M2, PC, 0, 0, symbol);
-  }
+  literalPoolProcessing(CALL_OC, CALL_M2, PC, 0, 0, symbol);
 }
 
 
 void Assembler::_jmp(int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M1, JMP_M5, 0, PC, 0, 0, literal);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M1, JMP_M5, 0, PC, 0, 0, literal);
 }
 
 
 void Assembler::_jmp(char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M5, PC, 0, 0, symbol);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M5, PC, 0, 0, symbol);
 }
 
 
 void Assembler::_beq(int gpr1, int gpr2, int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M2, JMP_M6, 0, PC, gpr1, gpr2, literal);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M2, JMP_M6, 0, PC, gpr1, gpr2, literal);
 }
 
 
 void Assembler::_beq(int gpr1, int gpr2, char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M6, PC, gpr1, gpr2, symbol);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M6, PC, gpr1, gpr2, symbol);
 }
 
 
 void Assembler::_bne(int gpr1, int gpr2, int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M3, JMP_M7, 0, PC, gpr1, gpr2, literal);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M3, JMP_M7, 0, PC, gpr1, gpr2, literal);
 }
 
 
 void Assembler::_bne(int gpr1, int gpr2, char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M7, PC, gpr1, gpr2, symbol);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M7, PC, gpr1, gpr2, symbol);
 }
 
 
 void Assembler::_bgt(int gpr1, int gpr2, int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M4, JMP_M8, 0, PC, gpr1, gpr2, literal);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M4, JMP_M8, 0, PC, gpr1, gpr2, literal);
 }
 
 
 void Assembler::_bgt(int gpr1, int gpr2, char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(JMP_OC, JMP_M8, PC, gpr1, gpr2, symbol);
-  }
+  literalPoolProcessing(JMP_OC, JMP_M8, PC, gpr1, gpr2, symbol);
 }
 
 // ------------------------------ PUSH/POP INSTRUCTIONS ------------------------------
 
 void Assembler::_push(int gpr)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ST_OC << 4) | ST_M3, (SP << 4), gpr << 4 | (getByte(-4, 1) & 0x0F), getByte(-4, 0));
-  }
+  codeInstruction((ST_OC << 4) | ST_M3, (SP << 4), gpr << 4 | (getByte(-4, 1) & 0x0F), getByte(-4, 0));
 }
 
 
 void Assembler::_pop(int gpr)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_GPR_M4, (gpr << 4) | SP, getByte(4, 1) & 0x0F, getByte(4, 0));
-  }
+  codeInstruction((LD_OC << 4) | LD_GPR_M4, (gpr << 4) | SP, getByte(4, 1) & 0x0F, getByte(4, 0));
 }
 
 // --------------------------------- ALU INSTRUCTIONS ---------------------------------
 
 void Assembler::_xchg(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction(XCHG_OC << 4, gprS, gprD << 4, 0);
-  }
+  codeInstruction(XCHG_OC << 4, gprS, gprD << 4, 0);
 }
 
 
 void Assembler::_add(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ARI_OP_OC << 4) | ADD, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((ARI_OP_OC << 4) | ADD, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_sub(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ARI_OP_OC << 4) | SUB, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((ARI_OP_OC << 4) | SUB, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_mul(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ARI_OP_OC << 4) | MUL, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((ARI_OP_OC << 4) | MUL, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_div(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ARI_OP_OC << 4) | DIV, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((ARI_OP_OC << 4) | DIV, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_not(int gpr)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LOG_OP_OC << 4) | NOT, (gpr << 4) | gpr, 0, 0);
-  }
+  codeInstruction((LOG_OP_OC << 4) | NOT, (gpr << 4) | gpr, 0, 0);
 }
 
 
 void Assembler::_and(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LOG_OP_OC << 4) | AND, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((LOG_OP_OC << 4) | AND, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_or(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LOG_OP_OC << 4) | OR, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((LOG_OP_OC << 4) | OR, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_xor(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LOG_OP_OC << 4) | XOR, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((LOG_OP_OC << 4) | XOR, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_shl(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((SH_OP_OC << 4) | SHL, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((SH_OP_OC << 4) | SHL, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_shr(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((SH_OP_OC << 4) | SHR, (gprD << 4) | gprD, gprS << 4, 0);
-  }
+  codeInstruction((SH_OP_OC << 4) | SHR, (gprD << 4) | gprD, gprS << 4, 0);
 }
 
 // -------------------------------------- LOAD --------------------------------------
 
 void Assembler::_ldImm(int literal, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(LD_OC, LD_GPR_M2, LD_GPR_M3, gprD, gprD, 0, PC, literal);
-  }
+  literalPoolProcessing(LD_OC, LD_GPR_M2, LD_GPR_M3, gprD, gprD, 0, PC, literal);
 }
 
 
 void Assembler::_ldImm(char *symbol, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(LD_OC, LD_GPR_M3, gprD, 0, PC, symbol);
-  }
+  literalPoolProcessing(LD_OC, LD_GPR_M3, gprD, 0, PC, symbol);
 }
 
 
 void Assembler::_ldMemDir(int literal, int gprD)
 {
-  if (first)
+  if (literal < D_MAX && literal > D_MIN)
   {
-    locationCounter += INSTR_SIZE * 4;
+    codeInstruction((LD_OC) << 4 | LD_GPR_M3, (gprD << 4), getByte(literal, 1) & 0x0F, getByte(literal, 0));
   }
   else
   {
-    if (literal < D_MAX && literal > D_MIN)
-    {
-      codeInstruction((LD_OC) << 4 | LD_GPR_M3, (gprD << 4), getByte(literal, 1) & 0x0F, getByte(literal, 0));
-    }
-    else
-    {
-      // Push r13
-      _push(13);
+    // Push r13
+    _push(13);
 
-      // First instruction; load literal in r13
-      literalPoolProcessing(LD_OC, 0, LD_GPR_M3, 0, 13, PC, 0, literal);
+    // First instruction; load literal in r13
+    literalPoolProcessing(LD_OC, 0, LD_GPR_M3, 0, 13, PC, 0, literal);
 
-      // Second instruction; gprD <= mem[r13]
-      _ldRegInd(13, gprD);
+    // Second instruction; gprD <= mem[r13]
+    _ldRegInd(13, gprD);
 
-      // Pop r13
-      _pop(13);
-    }
+    // Pop r13
+    _pop(13);
   }
 }
 
 
 void Assembler::_ldMemDir(char *symbol, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE * 4;
-  }
-  else
-  {
-    // Push r13
-    _push(13);
+  // Push r13
+  _push(13);
 
-    // First instruction; load literal in r13
-    literalPoolProcessing(LD_OC, LD_GPR_M3, 13, PC, 0, symbol);
+  // First instruction; load literal in r13
+  literalPoolProcessing(LD_OC, LD_GPR_M3, 13, PC, 0, symbol);
 
-    // Second instruction; gprD <= mem[r13]
-    _ldRegInd(13, gprD);
+  // Second instruction; gprD <= mem[r13]
+  _ldRegInd(13, gprD);
 
-    // Pop r13
-    _pop(13);
-  }
+  // Pop r13
+  _pop(13);
 }
 
 
 void Assembler::_ldReg(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_GPR_M2, (gprD << 4) | gprS, 0, 0);
-  }
+  codeInstruction((LD_OC << 4) | LD_GPR_M2, (gprD << 4) | gprS, 0, 0);
 }
 
 
 void Assembler::_ldRegInd(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_GPR_M3, (gprD << 4) | gprS, 0, 0);
-  }
+  codeInstruction((LD_OC << 4) | LD_GPR_M3, (gprD << 4) | gprS, 0, 0);
 }
 
 
 void Assembler::_ldRegIndOff(int gprS, int literal, int gprD)
 {
-  if (first)
+  if (literal < D_MAX)
   {
-    locationCounter += INSTR_SIZE;
+    codeInstruction((LD_OC << 4) | LD_GPR_M3, (gprD << 4) | gprS, getByte(literal, 1) & 0x0F, getByte(literal, 0));
   }
   else
   {
-    if (literal < D_MAX)
-    {
-      codeInstruction((LD_OC << 4) | LD_GPR_M3, (gprD << 4) | gprS, getByte(literal, 1) & 0x0F, getByte(literal, 0));
-    }
-    else
-    {
-      cout << "Literal in instruction load with register indirect address mode can't fit into instruction!";
-      exit(-3);
-    }
+    cout << "Literal in instruction load with register indirect address mode can't fit into instruction!";
+    exit(-3);
   }
 }
 
 
 void Assembler::_ldRegIndOff(int gprS, char *symbol, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    cout << "Literal in instruction load with register indirect address mode can't be symbol!" << endl;
-    exit(-3);
-  }
+  cout << "Literal in instruction load with register indirect address mode can't be symbol!" << endl;
+  exit(-3);
 }
 
 // -------------------------------------- STORE --------------------------------------
@@ -937,113 +692,57 @@ void Assembler::_stImm(int gpr, char *symbol)
 
 void Assembler::_stMemDir(int gprS, int literal)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(ST_OC, ST_M1, ST_M2, 0, PC, 0, gprS, literal);
-  }
+  literalPoolProcessing(ST_OC, ST_M1, ST_M2, 0, PC, 0, gprS, literal);
 }
 
 
 void Assembler::_stMemDir(int gprS, char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    literalPoolProcessing(ST_OC, ST_M2, PC, 0, gprS, symbol);
-  }
+  literalPoolProcessing(ST_OC, ST_M2, PC, 0, gprS, symbol);
 }
 
 
 void Assembler::_stReg(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_GPR_M2, (gprS << 4) | gprD, 0, 0);
-  }
+  codeInstruction((LD_OC << 4) | LD_GPR_M2, (gprS << 4) | gprD, 0, 0);
 }
 
 
 void Assembler::_stRegInd(int gprS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((ST_OC << 4) | ST_M1, gprD, gprS << 4, 0);
-  }
+  codeInstruction((ST_OC << 4) | ST_M1, gprD, gprS << 4, 0);
 }
 
 
 void Assembler::_stRegIndOff(int gprS, int gprD, int literal)
 {
-  if (first)
+  if (literal < D_MAX)
   {
-    locationCounter += INSTR_SIZE;
+    codeInstruction((ST_OC << 4) | ST_M1, gprD, (gprS << 4) | (getByte(literal, 1) & 0x0F), getByte(literal, 0));
   }
   else
   {
-    if (literal < D_MAX)
-    {
-      codeInstruction((ST_OC << 4) | ST_M1, gprD, (gprS << 4) | (getByte(literal, 1) & 0x0F), getByte(literal, 0));
-    }
-    else
-    {
-      cout << "Literal in instruction store with register indirect address mode can't fit into instruction!";
-      exit(-3);
-    }
+    cout << "Literal in instruction store with register indirect address mode can't fit into instruction!";
+    exit(-3);
   }
 }
 
 
 void Assembler::_stRegIndOff(int gprS, int gprD, char *symbol)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    cout << "Literal in instruction store with register indirect address mode can't be symbol!" << endl;
-    exit(-3);
-  }
+  cout << "Literal in instruction store with register indirect address mode can't be symbol!" << endl;
+  exit(-3);
 }
 
 // ------------------------------------ CSRRD/CSRWR ------------------------------------
 
 void Assembler::_csrrd(int csrS, int gprD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_GPR_M1, (gprD << 4) | csrS, 0, 0);
-  }
+  codeInstruction((LD_OC << 4) | LD_GPR_M1, (gprD << 4) | csrS, 0, 0);
 }
 
 
 void Assembler::_csrwr(int gprS, int csrD)
 {
-  if (first)
-  {
-    locationCounter += INSTR_SIZE;
-  }
-  else
-  {
-    codeInstruction((LD_OC << 4) | LD_CSR_M1, (csrD << 4) | gprS, 0, 0);
-  }
+  codeInstruction((LD_OC << 4) | LD_CSR_M1, (csrD << 4) | gprS, 0, 0);
 }
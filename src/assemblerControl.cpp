@@ -17,13 +17,25 @@ int main(int argc, char **argv)
     return -1;
   }
 
-  int asmFileIndex = 1;
+  int asmFileIndex = 0;
   char *outputFileName = strdup("file.o");
 
-  if (argc == 4 && !strcmp(argv[1], "-o"))
+  for (int i = 1; i < argc; i++)
   {
-    asmFileIndex = 3;
-    outputFileName = strdup(argv[2]);
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      outputFileName = strdup(argv[++i]);
+    else if (!strcmp(argv[i], "--text"))
+      Assembler::textOutput = true;
+    else if (!strcmp(argv[i], "--time"))
+      Assembler::timer.enabled = true;
+    else
+      asmFileIndex = i;
+  }
+
+  if (!asmFileIndex)
+  {
+    cout << "Invalid number of arguments!\n";
+    return -1;
   }
 
   // Open a file handle to a particular file:
@@ -39,20 +51,14 @@ int main(int argc, char **argv)
   // Set Flex to read from it instead of defaulting to STDIN:
   yyin = Assembler::asmFile;
 
-  // Open a file handle to an output text file:
-  Assembler::myElf->outputFile.open(outputFileName, ofstream::out);
+  // Open a file handle to an output file (binary object unless --text is given):
+  Assembler::myElf->outputFile.open(outputFileName, Assembler::textOutput ? ofstream::out : ofstream::out | ofstream::binary);
 
   // Initialize assembler data structures
   Assembler::init();
 
-  // First parse through the input:
-  yyparse();
-
-  // Return cursor to point at the begining of the file and set Flex to read from it
-  fseek(Assembler::asmFile, 0, SEEK_SET);
-  yyin = Assembler::asmFile;
-
-  // Second parse through the input
+  // Single parse through the input, forward references are resolved at .end
+  Assembler::timer.start();
   yyparse();
 
   // Deallocate allocated resources
@@ -1,134 +1,328 @@
-#include "../inc/emulator.h"
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../inc/emulator.h"
+#include "../inc/image.h"
+
+// Value of every hex digit character (-1 for other characters)
+static constexpr array<signed char, 256> hexValues() {
+  array<signed char, 256> values{};
+  for (int c = 0; c < 256; c++) values[c] = -1;
+  for (int c = '0'; c <= '9'; c++) values[c] = c - '0';
+  for (int c = 'a'; c <= 'f'; c++) values[c] = c - 'a' + 10;
+  for (int c = 'A'; c <= 'F'; c++) values[c] = c - 'A' + 10;
+  return values;
+}
 
-unordered_map<unsigned, char> Emulator::memory;
+static constexpr array<signed char, 256> hexValue = hexValues();
 
-vector<unsigned> Emulator::gpr;
-vector<unsigned> Emulator::csr;
+// Hex number starting at p (false if there is no digit)
+static inline bool scanHex(const unsigned char *&p, const unsigned char *end, unsigned &value) {
+  const unsigned char *start = p;
 
-char Emulator::OC;
-char Emulator::M;
-char Emulator::A;
-char Emulator::B;
-char Emulator::C;
-char Emulator::D1;
-char Emulator::D2_D3;
-int Emulator::D;
+  value = 0;
+  for (; p != end && hexValue[*p] >= 0; p++)
+    value = value << 4 | hexValue[*p];
+
+  return p != start;
+}
 
-string Emulator::message;
+// Image is mapped and scanned in place. Bytes go straight into guest pages,
+// the page is looked up again only when a line crosses into another one.
+void Machine::loadMemoryContent(string inputFileName) {
 
-void Emulator::loadMemoryContent(string inputFileName) {
+  int fd = open(inputFileName.c_str(), O_RDONLY);
+  struct stat st;
 
-  ifstream inputFile(inputFileName);
-  if (!inputFile) {
+  if (fd < 0 || fstat(fd, &st) < 0) {
     cout << "Failed to open a file!" << endl;
     exit(-2);
   }
 
-  string line;
-  unsigned int address;
-  char colon;
-  int value;
+  if (st.st_size == 0) {
+    close(fd);
+    return;
+  }
+
+  // Private writable mapping, guest writes to pages of a binary image are copied on write
+  void *mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    cout << "Failed to open a file!" << endl;
+    exit(-2);
+  }
+
+  if ((size_t)st.st_size >= sizeof(ImageHeader) && static_cast<ImageHeader *>(mapping)->magic == IMAGE_MAGIC) {
+    loadImage(static_cast<char *>(mapping), st.st_size);
+    return;
+  }
+
+  madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+  const unsigned char *p = static_cast<const unsigned char *>(mapping);
+  const unsigned char *end = p + st.st_size;
+
+  while (p != end) {
+
+    // Line is "address: byte byte ..."
+    unsigned address, value;
+
+    while (p != end && isspace(*p)) p++;
+    if (p == end) break;
+
+    bool valid = scanHex(p, end, address);
+
+    while (p != end && (*p == ' ' || *p == '\t')) p++;
+    valid = valid && p != end && *p == ':';
+    if (valid) p++;
+
+    char *page = nullptr;
+
+    while (valid) {
+      while (p != end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+      if (p == end || *p == '\n' || !scanHex(p, end, value)) break;
+
+      if (!page || (address & GUEST_PAGE_MASK) == 0)
+        page = memory.touch(address)->data;
+
+      page[address & GUEST_PAGE_MASK] = value;
+      address++;
+    }
+
+    // Rest of the line is not a byte
+    while (p != end && *p != '\n') p++;
+  }
+
+  munmap(mapping, st.st_size);
+}
 
-  while(getline(inputFile, line)) {
 
-    istringstream iss(line);
+// Pages fully covered by a segment become guest pages without copying (the
+// image stays mapped for the whole run), the rest is copied byte by byte
+void Machine::loadImage(char *image, size_t size) {
 
-    iss >> hex >> address;
-    iss >> colon;
+  ImageHeader *header = reinterpret_cast<ImageHeader *>(image);
+  SegmentHeader *segments = reinterpret_cast<SegmentHeader *>(header + 1);
 
-    while (iss >> hex >> value)
-      memory[address++] = value;
-    
+  if (header->version != IMAGE_VERSION ||
+      sizeof(ImageHeader) + (size_t)header->numOfSegments * sizeof(SegmentHeader) > size) {
+    cout << "Invalid image file!" << endl;
+    exit(-2);
   }
 
-  inputFile.close();
+  for (unsigned i = 0; i < header->numOfSegments; i++) {
+    SegmentHeader &segment = segments[i];
+
+    if (segment.offset > size || segment.size > size - segment.offset) {
+      cout << "Invalid image file!" << endl;
+      exit(-2);
+    }
+
+    char *data = image + segment.offset;
+    unsigned long long address = segment.address;
+    unsigned long long end = address + segment.size;
+
+    while (address < end) {
+      unsigned inPage = address & GUEST_PAGE_MASK;
+
+      // Whole page of the segment, its bytes are page aligned in the image
+      if (inPage == 0 && end - address >= GUEST_PAGE_SIZE &&
+          ((uintptr_t)data & GUEST_PAGE_MASK) == 0 && memory.attach(address, data)) {
+        address += GUEST_PAGE_SIZE;
+        data += GUEST_PAGE_SIZE;
+        continue;
+      }
+
+      unsigned count = min<unsigned long long>(GUEST_PAGE_SIZE - inPage, end - address);
+      memcpy(memory.touch(address)->data + inPage, data, count);
+      address += count;
+      data += count;
+    }
+  }
 }
 
 
-void Emulator::init() {
+Machine::Machine()
+  : running(false), currentBlock(nullptr), unaligned(), cycles(0), nextEvent(NEVER), timerGeneration(0),
+    terminalScheduled(false), pending(0), inputReady(false), stats(false), opCounts(), interruptCounts(), runSeconds(0),
+    profiling(false), tracer(nullptr), traceWrite(false), traceAddress(0),
+    traceValue(0), tracedInterrupt(0), console(true), forked(false) {}
+
+
+void Machine::init() {
 
   for (int i = 0; i < NUM_OF_GPR - 1; i++) gpr.push_back(0); // All but pc
   gpr.push_back(PC_INIT);
 
-  for (int i = 0; i < NUM_OF_CSR; i++) csr.push_back(0);
+  for (int i = 0; i < CSR_SPACE; i++) csr.push_back(0);
+
+  startDevices();
 }
 
 
-bool Emulator::fetchInstruction() {
+bool Machine::fetchInstruction() {
+
+  if (cycles >= nextEvent.load(memory_order_relaxed)) serviceEvents();
+  cycles++;
 
-  if (memory.find(gpr[pc]) == memory.end()) {
-    message = "Emulated processor program counter was on invalid address: " + gpr[pc] + '\n';
+  const Instruction *ins = decode(gpr[pc]);
+
+  if (!ins) {
+    invalidPC();
     return false;
   }
 
-  OC    = (memory[gpr[pc]] >> 4)  & LOWER_4_BITS;
-  M     =  memory[gpr[pc]++]      & LOWER_4_BITS;
-  A     = (memory[gpr[pc]] >> 4)  & LOWER_4_BITS;
-  B     = (memory[gpr[pc]++])     & LOWER_4_BITS;
-  C     = (memory[gpr[pc]] >> 4)  & LOWER_4_BITS;
-  D1    = (memory[gpr[pc]++]      & LOWER_4_BITS) << 4;
-  D2_D3 = (memory[gpr[pc]++]);
+  gpr[pc] += 4;
 
-  D = ((int)D1 << 4) | ((int)D2_D3 & 0xFF);
+  if (stats) opCounts[ins->OC << 4 | ins->M]++;
 
-  switch (OC) {
-    case HALT:  return _halt();
-    case INT:   _int();   break; 
-    case CALL:  _call();  break;
-    case JMP:   _jmp();   break;
-    case XCHG:  _xchg();  break;
-    case ARI:   _ari();   break;
-    case LOG:   _log();   break;
-    case SH:    _sh();    break;
-    case ST:    _st();    break;
-    case LD:    _ld();    break;
-    default:    return wrongOC();
+  return (this->*ins->execute)(*ins);
+}
+
+void Machine::run(const string &engine) {
+  this->engine = engine;
+
+  auto start = chrono::steady_clock::now();
+
+  if (tracer)
+    runTraced();
+  else if (engine == "threaded")
+    runThreaded();
+  else if (engine == "block")
+    runBlocks();
+  else
+    runReference();
+
+  runSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void Machine::runReference() {
+  while (fetchInstruction());
+}
+
+void Machine::invalidPC() {
+  stringstream ss;
+  ss << hex << gpr[pc];
+  message = "Emulated processor program counter was on invalid address: 0x" + ss.str() + '\n';
+}
+
+// Aligned instructions are decoded once and cached with their page
+const Instruction *Machine::decodeSlow(unsigned address) {
+
+  GuestPage *p = memory.entry(address);
+  if (!p) return nullptr;
+
+  if (address & 0x3) {
+    decodeInstruction(unaligned, memory.read32(address));
+    return &unaligned;
   }
 
-  return true;
+  if (!p->code) p->code = new CodePage(retired);
+
+  Instruction &ins = static_cast<CodePage *>(p->code)->slots[(address & GUEST_PAGE_MASK) >> 2];
+  decodeInstruction(ins, memory.read32(address));
+
+  return &ins;
+}
+
+void Machine::decodeInstruction(Instruction &ins, unsigned instruction) {
+
+  // Instruction bytes (lowest first): OC|M, A|B, C|D[11:8], D[7:0]
+  ins.OC = (instruction >> 4)  & LOWER_4_BITS;
+  ins.M  =  instruction        & LOWER_4_BITS;
+  ins.A  = (instruction >> 12) & LOWER_4_BITS;
+  ins.B  = (instruction >> 8)  & LOWER_4_BITS;
+  ins.C  = (instruction >> 20) & LOWER_4_BITS;
+  ins.D  = (int)(((instruction >> 16) & 0xF) << 28 | (instruction >> 24) << 20) >> 20;
+  ins.op = operation(ins.OC, ins.M);
+
+  switch (ins.OC) {
+    case HALT:  ins.execute = &Machine::_halt;  break;
+    case INT:   ins.execute = &Machine::_int;   break;
+    case CALL:  ins.execute = &Machine::_call;  break;
+    case JMP:   ins.execute = &Machine::_jmp;   break;
+    case XCHG:  ins.execute = &Machine::_xchg;  break;
+    case ARI:   ins.execute = &Machine::_ari;   break;
+    case LOG:   ins.execute = &Machine::_log;   break;
+    case SH:    ins.execute = &Machine::_sh;    break;
+    case ST:    ins.execute = &Machine::_st;    break;
+    case LD:    ins.execute = &Machine::_ld;    break;
+    default:    ins.execute = &Machine::wrongOC;
+  }
+
+  // Modes the other engines reject too (call has no mode that does nothing)
+  if (ins.op == OP_INVALID) ins.execute = &Machine::wrongOC;
+
+  // Counters are computed when they are read
+  if (ins.op == (LD << 4 | LD_M1) && (ins.B == CSR_INSTRET || ins.B == CSR_CYCLE))
+    ins.op = OP_COUNTER;
 }
 
-bool Emulator::wrongOC() {
+// Operation index of the instruction: OC << 4 | M for every pair that has its
+// own behaviour, modes that the instruction ignores are dropped
+unsigned char Machine::operation(unsigned char OC, unsigned char M) {
+  switch (OC) {
+    case HALT:
+    case INT:
+    case XCHG:  return OC << 4;
+    case CALL:  return M <= CALL_M2 ? OC << 4 | M : OP_INVALID;
+    case JMP:   return (M & 0x4) == 0 ? OC << 4 | M : OP_NOP;
+    case ARI:
+    case LOG:   return M <= 0x3 ? OC << 4 | M : OP_NOP;
+    case SH:    return M <= SHR ? OC << 4 | M : OP_NOP;
+    case ST:    return M <= ST_M2 ? OC << 4 | M : OP_NOP;
+    case LD:    return M <= LD_M8 ? OC << 4 | M : OP_NOP;
+    default:    return OP_INVALID;
+  }
+}
+
+bool Machine::wrongOC(const Instruction &) {
   message = "Emulated processor encountered instruction with invalid operation code!\n";
   return false;
 }
 
-bool Emulator::_halt() {
+bool Machine::_halt(const Instruction &) {
   message = "Emulated processor executed halt instruction\n";
   return false; 
 }
 
-void Emulator::_int() {
-  push(csr[status]);  
-  push(gpr[pc]);
-  csr[cause] = 4; 
-  csr[status] &= ~0x1;
-  gpr[pc] = csr[handler]; 
+bool Machine::_int(const Instruction &) {
+  interrupt(SOFTWARE_CAUSE);
+  return true;
 }
 
-void Emulator::_call() {
+bool Machine::_call(const Instruction &ins) {
 
   push(gpr[pc]);
   int newPC;
-  switch (M) {
-    case CALL_M1: newPC = gpr[A] + gpr[B] + D; break;
-    case CALL_M2: newPC = fetchData(gpr[A] + gpr[B] + D); break;
+  switch (ins.M) {
+    case CALL_M1: newPC = gpr[ins.A] + gpr[ins.B] + ins.D; break;
+    case CALL_M2: newPC = fetchData(gpr[ins.A] + gpr[ins.B] + ins.D); break;
+    default:      return wrongOC(ins);
   }
   gpr[pc] = newPC;
+  if (profiling) profileCall(false);
+  return true;
 }
 
-void Emulator::_jmp() {
+bool Machine::_jmp(const Instruction &ins) {
 
   int newPC = gpr[pc];
-  int imm = gpr[A] + D;
-  int mem = fetchData(gpr[A] + D);
-  int condition = (int)gpr[B] - (int)gpr[C];
+  int imm = gpr[ins.A] + ins.D;
+  int mem = fetchData(gpr[ins.A] + ins.D);
+  int condition = (int)gpr[ins.B] - (int)gpr[ins.C];
 
-  switch(M) {
+  switch(ins.M) {
     case JMP_M1 :                     newPC = imm; break;
     case JMP_M2 : if (!condition)     newPC = imm; break;
     case JMP_M3 : if (condition)      newPC = imm; break;
@@ -140,94 +334,110 @@ void Emulator::_jmp() {
   }
 
   gpr[pc] = newPC;
+  return true;
 }
 
-void Emulator::_xchg() {
-  int temp = gpr[B];
-  gpr[B] = gpr[C];
-  gpr[C] = gpr[B];
+bool Machine::_xchg(const Instruction &ins) {
+  int temp = gpr[ins.B];
+  gpr[ins.B] = gpr[ins.C];
+  gpr[ins.C] = temp;
+  return true;
 }
 
-void Emulator::_ari() {
-  switch(M) {
-    case ADD: gpr[A] = gpr[B] + gpr[C]; break;
-    case SUB: gpr[A] = gpr[B] - gpr[C]; break;
-    case MUL: gpr[A] = gpr[B] * gpr[C]; break;
-    case DIV: gpr[A] = gpr[B] / gpr[C]; break;
+bool Machine::_ari(const Instruction &ins) {
+  switch(ins.M) {
+    case ADD: gpr[ins.A] = gpr[ins.B] + gpr[ins.C]; break;
+    case SUB: gpr[ins.A] = gpr[ins.B] - gpr[ins.C]; break;
+    case MUL: gpr[ins.A] = gpr[ins.B] * gpr[ins.C]; break;
+    case DIV: gpr[ins.A] = gpr[ins.B] / gpr[ins.C]; break;
   }
+  return true;
 }
 
-void Emulator::_log() {
-  switch(M) {
-    case NOT: gpr[A] = ~gpr[B];         break;
-    case AND: gpr[A] = gpr[B] & gpr[C]; break;
-    case OR: gpr[A] = gpr[B] | gpr[C];  break;
-    case XOR: gpr[A] = gpr[B] ^ gpr[C]; break;
+bool Machine::_log(const Instruction &ins) {
+  switch(ins.M) {
+    case NOT: gpr[ins.A] = ~gpr[ins.B];             break;
+    case AND: gpr[ins.A] = gpr[ins.B] & gpr[ins.C]; break;
+    case OR: gpr[ins.A] = gpr[ins.B] | gpr[ins.C];  break;
+    case XOR: gpr[ins.A] = gpr[ins.B] ^ gpr[ins.C]; break;
   }
+  return true;
 }
 
-void Emulator::_sh() {
-  switch(M) {
-    case SHL: gpr[A] = gpr[B] << gpr[C]; break;
-    case SHR: gpr[A] = gpr[B] >> gpr[C]; break;
+bool Machine::_sh(const Instruction &ins) {
+  switch(ins.M) {
+    case SHL: gpr[ins.A] = gpr[ins.B] << gpr[ins.C]; break;
+    case SHR: gpr[ins.A] = gpr[ins.B] >> gpr[ins.C]; break;
   }
+  return true;
 }
 
-void Emulator::_st() {
-  switch(M) {
-    case ST_M1: insertData(gpr[A] + gpr[B] + D, gpr[C]);            break;
-    case ST_M2: insertData(fetchData(gpr[A] + gpr[B] + D), gpr[C]); break;
-    case ST_M3: gpr[A] = gpr[A] + D; insertData(gpr[A], gpr[C]);    break;
+bool Machine::_st(const Instruction &ins) {
+  switch(ins.M) {
+    case ST_M1: insertData(gpr[ins.A] + gpr[ins.B] + ins.D, gpr[ins.C]);            break;
+    case ST_M2: insertData(fetchData(gpr[ins.A] + gpr[ins.B] + ins.D), gpr[ins.C]); break;
+    case ST_M3: gpr[ins.A] = gpr[ins.A] + ins.D; insertData(gpr[ins.A], gpr[ins.C]); break;
   }
+  return true;
 }
 
 
-void Emulator::_ld()
+bool Machine::_ld(const Instruction &ins)
 {
-  switch(M) {
-    case LD_M1: gpr[A] = csr[B];                                  break;
-    case LD_M2: gpr[A] = gpr[B] + D;                              break;
-    case LD_M3: gpr[A] = fetchData(gpr[B] + gpr[C] + D);          break;
-    case LD_M4: gpr[A] = fetchData(gpr[B]); gpr[B] = gpr[B] + D;  break;
-    case LD_M5: csr[A] = gpr[B];                                  break;
-    case LD_M6: csr[A] = csr[B] | D;                              break;
-    case LD_M7: csr[A] = fetchData(gpr[B] + gpr[C] + D);          break;
-    case LD_M8: csr[A] = fetchData(gpr[B]); gpr[B] = gpr[B] + D;  break;
+  switch(ins.M) {
+    case LD_M1: gpr[ins.A] = ins.op == OP_COUNTER ? readCounter(ins.B) : csr[ins.B]; break;
+    case LD_M2: gpr[ins.A] = gpr[ins.B] + ins.D;                                  break;
+    case LD_M3: gpr[ins.A] = fetchData(gpr[ins.B] + gpr[ins.C] + ins.D);          break;
+    case LD_M4: gpr[ins.A] = fetchData(gpr[ins.B]); gpr[ins.B] = gpr[ins.B] + ins.D; break;
+    case LD_M5: csr[ins.A] = gpr[ins.B];                                          break;
+    case LD_M6: csr[ins.A] = csr[ins.B] | ins.D;                                  break;
+    case LD_M7: csr[ins.A] = fetchData(gpr[ins.B] + gpr[ins.C] + ins.D);          break;
+    case LD_M8: csr[ins.A] = fetchData(gpr[ins.B]); gpr[ins.B] = gpr[ins.B] + ins.D; break;
   }
-}
 
-void Emulator::push(int value) {
-  for (int i = 3; i >= 0; i--)
-    memory[--gpr[sp]] = getByte(value, i);  
+  // Written csr may unmask a pending interrupt
+  if (ins.M >= LD_M5) updateNextEvent();
+  return true;
 }
 
-char Emulator::getByte(int value, int byteIndex) {
-  return (value >> (byteIndex * 8)) & 0xFF;
+unsigned Machine::readCounter(unsigned index) {
+  switch (index) {
+    case CSR_INSTRET: return cycles - 1; // current instruction isn't retired yet
+    case CSR_CYCLE:   return cycles;
+    default:          return csr[index];
+  }
 }
 
-int Emulator::fetchData(int address) {
-
-  int data = 0;
+void Machine::push(int value) {
+  gpr[sp] -= 4;
+  memory.write32(gpr[sp], value);
 
-  for (int i = 3; i >= 0; i--) {
-    data <<= 8;
-    data |= (unsigned char)memory[address + i];
+  if (tracer) {
+    traceWrite = true;
+    traceAddress = gpr[sp];
+    traceValue = value;
   }
+}
 
-  return data;
+int Machine::fetchData(int address) {
+  return memory.read32(address);
 }
 
-void Emulator::insertData(int address, int value) {
-  for (int i = 0; i < 4; i++) {
-    memory[address + i] = getByte(value, i);
+void Machine::insertData(int address, int value) {
+  memory.write32(address, value);
+
+  if (tracer) {
+    traceWrite = true;
+    traceAddress = address;
+    traceValue = value;
   }
 }
 
-void Emulator::printProcossorState() {
+void Machine::printProcossorState() {
   cout << message;
   cout << "Emulated processor state:";
 
-  for (int i = 0; i < gpr.size(); i++) {
+  for (size_t i = 0; i < gpr.size(); i++) {
     if (i % 4 == 0) cout << endl;
     cout << "r" << dec << i << "=0x" << hex << setw(8) << setfill('0') << gpr[i] << '\t';
   }
@@ -0,0 +1,410 @@
+#include "../inc/emulator.h"
+
+// Block engine: straight-line guest code is translated once into a vector of
+// micro operations with bound operands. A block runs in one call and pc is
+// written only when the block is left.
+
+CodePage::~CodePage() {
+  for (Block *b : blocks)
+    delete b;
+}
+
+void CodePage::invalidate(unsigned offset) {
+  Instruction &ins = slots[offset >> 2];
+
+  // Plain data was written
+  if (!ins.execute) return;
+
+  ins.execute = nullptr;
+
+  if (numOfBlocks == 0) return;
+
+  for (Block *&b : blocks) {
+    if (!b) continue;
+
+    b->valid = false;
+    retired.push_back(b);
+    b = nullptr;
+  }
+
+  numOfBlocks = 0;
+}
+
+
+void Machine::runBlocks() {
+
+  running = true;
+
+  while (running) {
+
+    // Events are serviced between blocks
+    if (cycles >= nextEvent.load(memory_order_relaxed)) serviceEvents();
+
+    // Unaligned code is never translated, it runs one instruction at a time
+    if (gpr[pc] & 0x3) {
+      running = fetchInstruction();
+      continue;
+    }
+
+    Block *b = block(gpr[pc]);
+
+    if (!b) {
+      invalidPC();
+      return;
+    }
+
+    currentBlock = b;
+
+    const MicroOp *op = b->ops.data();
+    const MicroOp *last = op + b->ops.size() - 1;
+
+    for (; op != last; op++)
+      if (!op->run(*this, *op)) break;
+
+    if (op == last) {
+      cycles += (b->end - b->start) >> 2;
+      gpr[pc] = b->end;
+      last->run(*this, *last);
+    }
+    else {
+      cycles += (op->next - b->start) >> 2;
+      gpr[pc] = op->next;
+    }
+
+    if (stats)
+      for (const MicroOp *o = b->ops.data(); o <= op; o++)
+        if (o->code != OP_NOP) opCounts[o->code]++;
+
+    for (Block *r : retired)
+      delete r;
+    retired.clear();
+  }
+}
+
+
+// Translate block starting on the aligned address
+Block *Machine::translate(unsigned address) {
+
+  if (!decode(address)) return nullptr;
+
+  Block *b = new Block();
+  b->start = address;
+  b->valid = true;
+
+  for (;;) {
+    const Instruction *ins = decode(address);
+
+    // Next instruction is on invalid address, block engine will report it
+    if (!ins) break;
+
+    address += 4;
+
+    // Micro operation reading pc sees the address of the following instruction
+    if (readsPC(*ins)) {
+      MicroOp setPC = {};
+      setPC.run = [](Machine &m, const MicroOp &op) { m.gpr[pc] = op.next; return true; };
+      setPC.code = OP_NOP;
+      setPC.next = address;
+      b->ops.push_back(setPC);
+    }
+
+    MicroOp op = microOp(*ins);
+    op.next = address;
+    b->ops.push_back(op);
+
+    if (endsBlock(*ins) || (address & GUEST_PAGE_MASK) == 0 || b->ops.size() >= MAX_BLOCK_SIZE)
+      break;
+  }
+
+  b->end = address;
+
+  CodePage *code = static_cast<CodePage *>(memory.entry(b->start)->code);
+  code->blocks[(b->start & GUEST_PAGE_MASK) >> 2] = b;
+  code->numOfBlocks++;
+
+  return b;
+}
+
+
+bool Machine::readsPC(const Instruction &ins) {
+  return ins.A == pc || ins.B == pc || ins.C == pc;
+}
+
+
+bool Machine::endsBlock(const Instruction &ins) {
+
+  if (ins.op == OP_NOP) return false;
+  if (ins.op == OP_COUNTER) return ins.A == pc;
+
+  switch (ins.op >> 4) {
+    case HALT:
+    case INT:
+    case CALL:
+    case JMP:   return true;
+    case XCHG:  return ins.B == pc || ins.C == pc;
+    case ARI:
+    case LOG:
+    case SH:    return ins.A == pc;
+    case ST:    return ins.M == ST_M3 && ins.A == pc;
+    case LD:
+      // Writes to csr
+      if (ins.M >= LD_M5) return true;
+      return ins.A == pc || (ins.M == LD_M4 && ins.B == pc);
+    default:    return true;
+  }
+}
+
+
+MicroOp Machine::microOp(const Instruction &ins) {
+
+  MicroOp op = {};
+  op.A = ins.A;
+  op.B = ins.B;
+  op.C = ins.C;
+  op.D = ins.D;
+  op.code = ins.OC << 4 | ins.M;
+
+  switch (ins.op) {
+
+    // -------------------------------- CONTROL --------------------------------
+
+    case HALT << 4:
+      op.run = [](Machine &m, const MicroOp &) { m._halt(Instruction()); return m.running = false; };
+      break;
+
+    case INT << 4:
+      op.run = [](Machine &m, const MicroOp &) { m.interrupt(SOFTWARE_CAUSE); return true; };
+      break;
+
+    case CALL << 4 | CALL_M1:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.push(m.gpr[pc]);
+        m.gpr[pc] = m.gpr[op.A] + m.gpr[op.B] + op.D;
+        if (m.profiling) m.profileCall(false);
+        return true;
+      };
+      break;
+
+    case CALL << 4 | CALL_M2:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.push(m.gpr[pc]);
+        m.gpr[pc] = m.memory.read32(m.gpr[op.A] + m.gpr[op.B] + op.D);
+        if (m.profiling) m.profileCall(false);
+        return true;
+      };
+      break;
+
+    // --------------------------------- JUMPS ---------------------------------
+
+    case JMP << 4 | JMP_M1:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[pc] = m.gpr[op.A] + op.D; return true; };
+      break;
+
+    case JMP << 4 | JMP_M2:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if (m.gpr[op.B] == m.gpr[op.C]) m.gpr[pc] = m.gpr[op.A] + op.D;
+        return true;
+      };
+      break;
+
+    case JMP << 4 | JMP_M3:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if (m.gpr[op.B] != m.gpr[op.C]) m.gpr[pc] = m.gpr[op.A] + op.D;
+        return true;
+      };
+      break;
+
+    case JMP << 4 | JMP_M4:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if ((int)m.gpr[op.B] - (int)m.gpr[op.C] > 0) m.gpr[pc] = m.gpr[op.A] + op.D;
+        return true;
+      };
+      break;
+
+    case JMP << 4 | JMP_M5:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[pc] = m.memory.read32(m.gpr[op.A] + op.D); return true; };
+      break;
+
+    case JMP << 4 | JMP_M6:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if (m.gpr[op.B] == m.gpr[op.C]) m.gpr[pc] = m.memory.read32(m.gpr[op.A] + op.D);
+        return true;
+      };
+      break;
+
+    case JMP << 4 | JMP_M7:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if (m.gpr[op.B] != m.gpr[op.C]) m.gpr[pc] = m.memory.read32(m.gpr[op.A] + op.D);
+        return true;
+      };
+      break;
+
+    case JMP << 4 | JMP_M8:
+      op.run = [](Machine &m, const MicroOp &op) {
+        if ((int)m.gpr[op.B] - (int)m.gpr[op.C] > 0) m.gpr[pc] = m.memory.read32(m.gpr[op.A] + op.D);
+        return true;
+      };
+      break;
+
+    // ---------------------------------- ALU ----------------------------------
+
+    case XCHG << 4:
+      op.run = [](Machine &m, const MicroOp &op) {
+        unsigned temp = m.gpr[op.B];
+        m.gpr[op.B] = m.gpr[op.C];
+        m.gpr[op.C] = temp;
+        return true;
+      };
+      break;
+
+    case ARI << 4 | ADD:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] + m.gpr[op.C]; return true; };
+      break;
+
+    case ARI << 4 | SUB:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] - m.gpr[op.C]; return true; };
+      break;
+
+    case ARI << 4 | MUL:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] * m.gpr[op.C]; return true; };
+      break;
+
+    case ARI << 4 | DIV:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] / m.gpr[op.C]; return true; };
+      break;
+
+    case LOG << 4 | NOT:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = ~m.gpr[op.B]; return true; };
+      break;
+
+    case LOG << 4 | AND:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] & m.gpr[op.C]; return true; };
+      break;
+
+    case LOG << 4 | OR:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] | m.gpr[op.C]; return true; };
+      break;
+
+    case LOG << 4 | XOR:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] ^ m.gpr[op.C]; return true; };
+      break;
+
+    case SH << 4 | SHL:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] << m.gpr[op.C]; return true; };
+      break;
+
+    case SH << 4 | SHR:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] >> m.gpr[op.C]; return true; };
+      break;
+
+    // --------------------------------- STORE ---------------------------------
+
+    // Store that overwrites the running block leaves it
+
+    case ST << 4 | ST_M1:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.memory.write32(m.gpr[op.A] + m.gpr[op.B] + op.D, m.gpr[op.C]);
+        return m.currentBlock->valid;
+      };
+      break;
+
+    case ST << 4 | ST_M2:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.memory.write32(m.memory.read32(m.gpr[op.A] + m.gpr[op.B] + op.D), m.gpr[op.C]);
+        return m.currentBlock->valid;
+      };
+      break;
+
+    case ST << 4 | ST_M3:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.gpr[op.A] += op.D;
+        m.memory.write32(m.gpr[op.A], m.gpr[op.C]);
+        return m.currentBlock->valid;
+      };
+      break;
+
+    // ---------------------------------- LOAD ---------------------------------
+
+    case LD << 4 | LD_M1:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.csr[op.B]; return true; };
+      break;
+
+    // Cycles of the running block are added when the block is left (before
+    // its last operation runs)
+    case OP_COUNTER:
+      op.run = [](Machine &m, const MicroOp &op) {
+        bool last = &op == &m.currentBlock->ops.back();
+        unsigned done = last ? 0 : (op.next - m.currentBlock->start) >> 2;
+        m.cycles += done;
+        m.gpr[op.A] = m.readCounter(op.B);
+        m.cycles -= done;
+        return true;
+      };
+      break;
+
+    case LD << 4 | LD_M2:
+      op.run = [](Machine &m, const MicroOp &op) { m.gpr[op.A] = m.gpr[op.B] + op.D; return true; };
+      break;
+
+    case LD << 4 | LD_M3:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.gpr[op.A] = m.memory.read32(m.gpr[op.B] + m.gpr[op.C] + op.D);
+        return true;
+      };
+      break;
+
+    case LD << 4 | LD_M4:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.gpr[op.A] = m.memory.read32(m.gpr[op.B]);
+        m.gpr[op.B] += op.D;
+        return true;
+      };
+      break;
+
+    // Written csr may unmask a pending interrupt
+
+    case LD << 4 | LD_M5:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.csr[op.A] = m.gpr[op.B];
+        m.updateNextEvent();
+        return true;
+      };
+      break;
+
+    case LD << 4 | LD_M6:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.csr[op.A] = m.csr[op.B] | op.D;
+        m.updateNextEvent();
+        return true;
+      };
+      break;
+
+    case LD << 4 | LD_M7:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.csr[op.A] = m.memory.read32(m.gpr[op.B] + m.gpr[op.C] + op.D);
+        m.updateNextEvent();
+        return true;
+      };
+      break;
+
+    case LD << 4 | LD_M8:
+      op.run = [](Machine &m, const MicroOp &op) {
+        m.csr[op.A] = m.memory.read32(m.gpr[op.B]);
+        m.gpr[op.B] += op.D;
+        m.updateNextEvent();
+        return true;
+      };
+      break;
+
+    // ---------------------------------- OTHER --------------------------------
+
+    case OP_NOP:
+      op.run = [](Machine &, const MicroOp &) { return true; };
+      break;
+
+    default:
+      op.run = [](Machine &m, const MicroOp &) { m.wrongOC(Instruction()); return m.running = false; };
+  }
+
+  return op;
+}
@@ -1,25 +1,176 @@
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include "../inc/emulator.h"
 
 using namespace std;
 
+string inputFileName;
+string engine = "reference";
+
+string saveFileName;
+string restoreFileName;
+unsigned long long snapshotAt;
+bool snapshot = false;
+
+unsigned long long forkAt;
+bool forks = false;
+vector<string> forkInputs;
+
+int numOfCores = 1;
+bool stats = false;
+
+string profileFileName;
+string mapFileName;
+string traceFileName;
+
+Machine machine;
+
+void loadArguments(int argc, char **argv);
+
 int main(int argc, char **argv) {
 
-  if (argc < 2) {
-    cout << "Input file isn't specified!" << endl;
-    return -1;
+  loadArguments(argc, argv);
+
+  if (numOfCores > 1) {
+    machine.loadMemoryContent(inputFileName);
+
+    vector<Machine *> cores = machine.startCores(numOfCores);
+
+    if (stats)
+      for (Machine *core : cores) core->collectStats();
+
+    Machine::runMachines(cores, engine);
+
+    for (int i = 0; i < numOfCores; i++) {
+      cout << "Core " << dec << i << ":" << endl;
+      cores[i]->printProcossorState();
+      if (stats) cores[i]->printStats();
+    }
+
+    return 0;
   }
 
-  string inputFileName = argv[1];
+  if (restoreFileName.empty())
+    machine.loadMemoryContent(inputFileName);
+
+  machine.init();
+
+  if (!restoreFileName.empty())
+    machine.restoreSnapshot(restoreFileName);
+
+  if (snapshot)
+    machine.scheduleSnapshot(snapshotAt, saveFileName);
+
+  if (forks)
+    machine.scheduleForks(forkAt, forkInputs);
+
+  if (stats)
+    machine.collectStats();
+
+  if (!profileFileName.empty())
+    machine.profile(profileFileName, mapFileName);
+
+  if (!traceFileName.empty())
+    machine.trace(traceFileName);
 
-  Emulator::loadMemoryContent(inputFileName);
+  machine.run(engine);
 
-  Emulator::init();
+  machine.writeProfile();
 
-  while (Emulator::fetchInstruction());
+  machine.printProcossorState();
 
-  Emulator::printProcossorState();
+  if (stats)
+    machine.printStats();
 
   return 0;
-}
\ No newline at end of file
+}
+
+
+void loadArguments(int argc, char **argv) {
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+
+    if (arg.find("--engine=") == 0) {
+      engine = arg.substr(9);
+
+      if (engine != "reference" && engine != "threaded" && engine != "block") {
+        cout << "Unknown engine " << engine << " (use reference, threaded or block)!" << endl;
+        exit(-3);
+      }
+    }
+    else if (arg.find("--cores=") == 0) {
+      numOfCores = atoi(arg.c_str() + 8);
+
+      if (numOfCores < 1) {
+        cout << "Number of cores must be positive!" << endl;
+        exit(-3);
+      }
+    }
+    else if (arg == "--stats") {
+      stats = true;
+    }
+    else if (arg.find("--snapshot-at=") == 0) {
+      snapshotAt = strtoull(arg.c_str() + 14, nullptr, 0);
+      snapshot = true;
+    }
+    else if (arg.find("--fork-at=") == 0) {
+      forkAt = strtoull(arg.c_str() + 10, nullptr, 0);
+      forks = true;
+    }
+    else if (arg.find("--fork-input=") == 0) {
+      forkInputs.push_back(arg.substr(13));
+    }
+    else if (arg.find("--profile=") == 0) {
+      profileFileName = arg.substr(10);
+    }
+    else if (arg.find("--trace=") == 0) {
+      traceFileName = arg.substr(8);
+    }
+    else if (arg.find("--map=") == 0) {
+      mapFileName = arg.substr(6);
+    }
+    else if (arg.find("--save=") == 0) {
+      saveFileName = arg.substr(7);
+    }
+    else if (arg.find("--restore=") == 0) {
+      restoreFileName = arg.substr(10);
+    }
+    else {
+      inputFileName = arg;
+    }
+  }
+
+  if (snapshot != !saveFileName.empty()) {
+    cout << "Snapshot needs both --snapshot-at and --save!" << endl;
+    exit(-3);
+  }
+
+  if (forks != !forkInputs.empty()) {
+    cout << "Forks need both --fork-at and at least one --fork-input!" << endl;
+    exit(-3);
+  }
+
+  if (numOfCores > 1 && (snapshot || forks || !restoreFileName.empty())) {
+    cout << "Snapshots and forks need a machine with one core!" << endl;
+    exit(-3);
+  }
+
+  // Only the reference engine executes one instruction at a time
+  if (!traceFileName.empty() && engine != "reference") {
+    cout << "Trace needs the reference engine!" << endl;
+    exit(-3);
+  }
+
+  if (numOfCores > 1 && (!profileFileName.empty() || !traceFileName.empty())) {
+    cout << "Profiler and trace need a machine with one core!" << endl;
+    exit(-3);
+  }
+
+  // Restored machine brings its own memory
+  if (inputFileName.empty() && restoreFileName.empty()) {
+    cout << "Input file isn't specified!" << endl;
+    exit(-1);
+  }
+}
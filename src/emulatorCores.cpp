@@ -0,0 +1,32 @@
+#include "../inc/emulator.h"
+
+// Machine with several processors: every core is a machine of its own with
+// registers, csrs, timer and code caches, and all cores share the guest
+// memory of the machine they were started from. That machine only holds the
+// memory, it doesn't run.
+//
+// Aligned words are read and written atomically and writes are sequentially
+// consistent, so guest locks built on plain loads and stores (Peterson,
+// bakery) work. Code written by one core is not seen by code caches of the
+// other cores.
+//
+// The first core reads the host terminal and receives its interrupts. Every
+// core has its own timer, started by its own write to tim_cfg.
+
+vector<Machine *> Machine::startCores(int numOfCores) {
+
+  vector<Machine *> cores;
+
+  for (int i = 0; i < numOfCores; i++) {
+    Machine *core = new Machine();
+    core->memory.viewOf(memory);
+    core->console = i == 0;
+
+    core->init();
+    core->csr[coreid] = i;
+
+    cores.push_back(core);
+  }
+
+  return cores;
+}
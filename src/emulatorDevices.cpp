@@ -0,0 +1,188 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <termios.h>
+#include <unistd.h>
+#include "../inc/emulator.h"
+
+static struct termios savedTerminal;
+
+// Ctrl-C or a kill ends the process without atexit handlers, so the terminal
+// is restored here and the signal raised again with its default action
+static void restoreTerminalAndRaise(int signal) {
+  Machine::restoreTerminal();
+  raise(signal);
+}
+
+// Timer periods in milliseconds for every tim_cfg value
+static const unsigned timerPeriods[] = {500, 1000, 1500, 2000, 5000, 10000, 30000, 60000};
+
+// -------------------------------- INTERRUPTS --------------------------------
+
+void Machine::interrupt(unsigned interruptCause) {
+  interruptCounts[interruptCause]++;
+  if (tracer) tracedInterrupt = interruptCause;
+
+  push(csr[status]);
+  push(gpr[pc]);
+  csr[cause] = interruptCause;
+  csr[status] &= ~0x1;
+  gpr[pc] = csr[handler];
+  if (profiling) profileCall(true);
+
+  updateNextEvent();
+}
+
+bool Machine::deliverable() {
+  if (csr[status] & INTERRUPT_MASK) return false;
+
+  return ((pending & (1 << TIMER_CAUSE)) && !(csr[status] & TIMER_MASK))
+      || ((pending & (1 << TERMINAL_CAUSE)) && !(csr[status] & TERMINAL_MASK));
+}
+
+// Called by an engine when the cycle counter reached nextEvent
+void Machine::serviceEvents() {
+
+  // Characters arrived since the last service
+  if (inputReady.exchange(false) && !terminalScheduled) {
+    events.push({cycles, TERMINAL_EVENT, 0});
+    terminalScheduled = true;
+  }
+
+  while (!events.empty() && events.top().cycle <= cycles) {
+    Event e = events.top();
+    events.pop();
+
+    switch (e.type) {
+
+      case TIMER_EVENT:
+        // Timer was reprogrammed after this event was scheduled
+        if (e.generation != timerGeneration) break;
+
+        pending |= 1 << TIMER_CAUSE;
+        events.push({cycles + (unsigned long long)timerPeriods[memory.read32(TIM_CFG) & 0x7] * CYCLES_PER_MS,
+                     TIMER_EVENT, timerGeneration});
+        break;
+
+      case TERMINAL_EVENT: {
+        lock_guard<mutex> lock(inputMutex);
+
+        if (!input.empty()) {
+          memory.write32(TERM_IN, (unsigned char)input.front());
+          input.pop_front();
+          pending |= 1 << TERMINAL_CAUSE;
+        }
+
+        // One character at a time, the guest needs time to read it
+        terminalScheduled = !input.empty();
+        if (terminalScheduled) events.push({cycles + TERMINAL_DELAY, TERMINAL_EVENT, 0});
+        break;
+      }
+
+      case SNAPSHOT_EVENT:
+        saveSnapshot();
+        break;
+
+      case FORK_EVENT:
+        startForks();
+        break;
+
+      case PROFILE_EVENT:
+        profileSample();
+        events.push({cycles + PROFILE_PERIOD, PROFILE_EVENT, 0});
+        break;
+    }
+  }
+
+  if (deliverable()) {
+    unsigned interruptCause = (pending & (1 << TIMER_CAUSE)) && !(csr[status] & TIMER_MASK) ? TIMER_CAUSE : TERMINAL_CAUSE;
+    pending &= ~(1 << interruptCause);
+    interrupt(interruptCause);
+  }
+
+  updateNextEvent();
+}
+
+// Also called after every write to a csr, which may unmask a pending interrupt
+void Machine::updateNextEvent() {
+  unsigned long long next = events.empty() ? NEVER : events.top().cycle;
+  if (pending && deliverable()) next = cycles;
+
+  nextEvent.store(next);
+
+  // Reader thread may have set nextEvent between the two stores
+  if (inputReady.load()) nextEvent.store(0);
+}
+
+// -------------------------------- PERIPHERALS --------------------------------
+
+void Machine::startDevices() {
+
+  memory.mapDevices(MMIO_START, deviceWrite, this);
+
+  // Other machines are fed by their creator
+  if (!console) return;
+
+  // Characters are delivered as they are typed, without echo
+  if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &savedTerminal) == 0) {
+    struct termios raw = savedTerminal;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    atexit(restoreTerminal);
+
+    struct sigaction action = {};
+    action.sa_handler = restoreTerminalAndRaise;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int signal : {SIGINT, SIGTERM, SIGHUP}) sigaction(signal, &action, nullptr);
+  }
+
+  // Blocking reads happen on their own thread, never in the interpreter loop
+  thread(&Machine::readTerminal, this).detach();
+}
+
+void Machine::restoreTerminal() {
+  tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+}
+
+void Machine::readTerminal() {
+  char c;
+
+  while (read(STDIN_FILENO, &c, 1) == 1)
+    feed(string(1, c));
+}
+
+// May be called from any thread
+void Machine::feed(const string &characters) {
+  {
+    lock_guard<mutex> lock(inputMutex);
+    input.insert(input.end(), characters.begin(), characters.end());
+  }
+
+  inputReady.store(true);
+  nextEvent.store(0);
+}
+
+void Machine::deviceWrite(void *context, unsigned address, unsigned value) {
+
+  Machine &m = *static_cast<Machine *>(context);
+
+  switch (address) {
+
+    case TERM_OUT:
+      if (m.forked)
+        m.output += (char)value;
+      else
+        cout << (char)value << flush;
+      break;
+
+    // Timer starts counting when it is configured for the first time
+    case TIM_CFG:
+      m.timerGeneration++;
+      m.events.push({m.cycles + (unsigned long long)timerPeriods[value & 0x7] * CYCLES_PER_MS,
+                     TIMER_EVENT, m.timerGeneration});
+      m.updateNextEvent();
+      break;
+  }
+}
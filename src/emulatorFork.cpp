@@ -0,0 +1,97 @@
+#include <iostream>
+#include <thread>
+#include "../inc/emulator.h"
+
+// Forked machine starts from the state of its parent. Guest memory pages are
+// shared until one of the machines writes to them, so a fork costs one page
+// table walk no matter how much memory the guest uses.
+
+Machine *Machine::fork() {
+
+  Machine *child = new Machine();
+  child->console = false;
+  child->forked = true;
+  child->engine = engine;
+
+  memory.shareWith(child->memory);
+
+  child->gpr = gpr;
+  child->csr = csr;
+
+  child->cycles = cycles;
+  child->pending = pending;
+  child->timerGeneration = timerGeneration;
+  child->terminalScheduled = terminalScheduled;
+
+  // Snapshots and forks stay with the parent
+  for (auto queue = events; !queue.empty(); queue.pop())
+    if (queue.top().type == TIMER_EVENT || queue.top().type == TERMINAL_EVENT)
+      child->events.push(queue.top());
+
+  {
+    lock_guard<mutex> lock(inputMutex);
+    child->input = input;
+  }
+  child->inputReady.store(inputReady.load());
+
+  child->startDevices();
+  child->updateNextEvent();
+
+  return child;
+}
+
+
+// Every machine runs on its own thread, returns when all of them stopped
+void Machine::runMachines(const vector<Machine *> &machines, const string &engine) {
+
+  vector<thread> threads;
+  for (Machine *m : machines)
+    threads.emplace_back(&Machine::run, m, engine);
+
+  for (thread &t : threads)
+    t.join();
+}
+
+
+// One fork for every input, started by the event loop
+void Machine::scheduleForks(unsigned long long cycle, const vector<string> &inputs) {
+  forkInputs = inputs;
+
+  events.push({cycle, FORK_EVENT, 0});
+  updateNextEvent();
+}
+
+
+void Machine::startForks() {
+
+  vector<Machine *> children;
+  for (const string &characters : forkInputs) {
+    Machine *child = fork();
+    if (!characters.empty()) child->feed(characters);
+    children.push_back(child);
+  }
+
+  runMachines(children, engine);
+
+  for (size_t i = 0; i < children.size(); i++) {
+    cout << "Fork " << dec << i << " (input \"" << forkInputs[i] << "\"):" << endl;
+    cout << children[i]->terminalOutput();
+    children[i]->printProcossorState();
+    cout << endl;
+
+    delete children[i];
+  }
+}
+
+
+unsigned Machine::getRegister(int index) const {
+  return gpr[index];
+}
+
+void Machine::setRegister(int index, unsigned value) {
+  gpr[index] = value;
+}
+
+string Machine::terminalOutput() const {
+  return output;
+}
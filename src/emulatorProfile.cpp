@@ -0,0 +1,73 @@
+#include <fstream>
+#include <iostream>
+#include "../inc/symbolMap.h"
+#include "../inc/emulator.h"
+
+// Sampling profiler (--profile). Every PROFILE_PERIOD cycles the event loop
+// records pc together with the guest call stack. The stack is rebuilt from the
+// return addresses that call and interrupts push: a frame lives while sp is at
+// or below the slot of its return address, so pop pc (ret) and iret end frames
+// without being watched. Output is in folded format (one "a;b;c count" line
+// per stack), symbolized with the linker's -map output. The block engine
+// services events between blocks, so its samples land on block starts.
+
+void Machine::profile(string fileName, string mapFileName) {
+  profiling = true;
+  profileFileName = fileName;
+  this->mapFileName = mapFileName;
+
+  events.push({cycles + PROFILE_PERIOD, PROFILE_EVENT, 0});
+  updateNextEvent();
+}
+
+// Called after a call or an interrupt pushed its return address
+void Machine::profileCall(bool interrupted) {
+  unsigned slot = gpr[sp];
+
+  // Frames the guest left without a return (sp was moved over them)
+  while (!callStack.empty() && callStack.back().slot <= slot) callStack.pop_back();
+
+  // Call returns past the call instruction, an interrupt to the interrupted one
+  unsigned returnAddress = memory.read32(slot);
+  callStack.push_back({slot, interrupted ? returnAddress : returnAddress - 4});
+}
+
+void Machine::profileSample() {
+  while (!callStack.empty() && callStack.back().slot < gpr[sp]) callStack.pop_back();
+
+  vector<unsigned> stack;
+  stack.reserve(callStack.size() + 1);
+  for (const ProfileFrame &frame : callStack) stack.push_back(frame.site);
+  stack.push_back(gpr[pc]);
+
+  samples[stack]++;
+}
+
+void Machine::writeProfile() {
+  if (!profiling) return;
+
+  SymbolMap symbols;
+  if (!mapFileName.empty() && !symbols.load(mapFileName))
+    cout << "Can't read symbol map " << mapFileName << ", profile has addresses only!" << endl;
+
+  // Different addresses in one routine fold into one stack
+  map<string, unsigned long long> folded;
+  for (auto &sample : samples) {
+    string stack;
+    for (unsigned address : sample.first) {
+      if (!stack.empty()) stack += ';';
+      stack += symbols.name(address);
+    }
+    folded[stack] += sample.second;
+  }
+
+  ofstream profileFile(profileFileName, ios::trunc);
+  for (auto &stack : folded)
+    profileFile << stack.first << ' ' << stack.second << '\n';
+  profileFile.close();
+
+  if (!profileFile) {
+    cout << "Can't write profile " << profileFileName << "!" << endl;
+    exit(-2);
+  }
+}
@@ -0,0 +1,156 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../inc/emulator.h"
+#include "../inc/snapshot.h"
+
+// Snapshot is taken by the event loop, between two instructions (between two
+// blocks for the block engine), so registers and memory are consistent
+
+void Machine::scheduleSnapshot(unsigned long long cycle, string fileName) {
+  snapshotFileName = fileName;
+
+  events.push({cycle, SNAPSHOT_EVENT, 0});
+  updateNextEvent();
+}
+
+
+void Machine::saveSnapshot() {
+
+  SnapshotHeader header = {};
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.pending = pending;
+  header.timerGeneration = timerGeneration;
+  header.terminalScheduled = terminalScheduled;
+  header.cycles = cycles;
+
+  for (int i = 0; i < NUM_OF_GPR; i++) header.gpr[i] = gpr[i];
+  for (int i = 0; i < CSR_SPACE; i++) header.csr[i] = csr[i];
+
+  // Queue is copied, the running machine keeps its events. Only peripherals
+  // are saved, later snapshots and forks belong to this run.
+  vector<SnapshotEvent> savedEvents;
+  for (auto queue = events; !queue.empty(); queue.pop())
+    if (queue.top().type == TIMER_EVENT || queue.top().type == TERMINAL_EVENT)
+      savedEvents.push_back({queue.top().cycle, (uint32_t)queue.top().type, queue.top().generation});
+
+  string savedInput;
+  {
+    lock_guard<mutex> lock(inputMutex);
+    savedInput.assign(input.begin(), input.end());
+  }
+
+  // Untouched memory reads as zero, so pages holding only zeros are left out
+  static const char zeros[GUEST_PAGE_SIZE] = {};
+
+  vector<uint32_t> addresses;
+  for (unsigned address : memory.pages())
+    if (memcmp(memory.page(address), zeros, GUEST_PAGE_SIZE) != 0)
+      addresses.push_back(address);
+
+  header.numOfPages = addresses.size();
+  header.numOfEvents = savedEvents.size();
+  header.inputSize = savedInput.size();
+
+  size_t tablesEnd = sizeof(header) + savedEvents.size() * sizeof(SnapshotEvent) + savedInput.size() +
+                     addresses.size() * sizeof(uint32_t);
+  size_t padding = (SNAPSHOT_PAGE_SIZE - tablesEnd % SNAPSHOT_PAGE_SIZE) % SNAPSHOT_PAGE_SIZE;
+
+  ofstream file(snapshotFileName, ios::binary | ios::trunc);
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(savedEvents.data()), savedEvents.size() * sizeof(SnapshotEvent));
+  file.write(savedInput.data(), savedInput.size());
+  file.write(reinterpret_cast<const char *>(addresses.data()), addresses.size() * sizeof(uint32_t));
+  file.write(zeros, padding);
+
+  for (unsigned address : addresses)
+    file.write(memory.page(address), GUEST_PAGE_SIZE);
+
+  file.flush();
+
+  if (!file) {
+    cout << "Failed to save a snapshot!" << endl;
+    exit(-2);
+  }
+}
+
+
+// Called after init(). Page contents are mapped privately and attached as
+// guest pages, nothing is read until the guest touches a page. The mapping
+// stays for the whole run.
+void Machine::restoreSnapshot(string fileName) {
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+    cout << "Failed to open a snapshot!" << endl;
+    exit(-2);
+  }
+
+  void *mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    cout << "Failed to open a snapshot!" << endl;
+    exit(-2);
+  }
+
+  char *base = static_cast<char *>(mapping);
+  size_t size = st.st_size;
+
+  const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(base);
+
+  size_t tablesEnd = sizeof(SnapshotHeader) + (size_t)header->numOfEvents * sizeof(SnapshotEvent) +
+                     header->inputSize + (size_t)header->numOfPages * sizeof(uint32_t);
+  size_t pagesStart = (tablesEnd + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE * SNAPSHOT_PAGE_SIZE;
+
+  if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+      pagesStart > size || (size - pagesStart) / SNAPSHOT_PAGE_SIZE < header->numOfPages) {
+    cout << "Invalid snapshot file!" << endl;
+    exit(-2);
+  }
+
+  const SnapshotEvent *savedEvents = reinterpret_cast<const SnapshotEvent *>(header + 1);
+  const char *savedInput = reinterpret_cast<const char *>(savedEvents + header->numOfEvents);
+  const uint32_t *addresses = reinterpret_cast<const uint32_t *>(savedInput + header->inputSize);
+
+  // ---------------------------------- MEMORY ----------------------------------
+
+  char *data = base + pagesStart;
+
+  for (uint32_t i = 0; i < header->numOfPages; i++, data += GUEST_PAGE_SIZE) {
+    unsigned address = addresses[i] & ~GUEST_PAGE_MASK;
+
+    // Pages touched by init() (memory mapped registers) are copied
+    if (!memory.attach(address, data))
+      memcpy(memory.touch(address)->data, data, GUEST_PAGE_SIZE);
+  }
+
+  // ---------------------------------- MACHINE ---------------------------------
+
+  for (int i = 0; i < NUM_OF_GPR; i++) gpr[i] = header->gpr[i];
+  for (int i = 0; i < CSR_SPACE; i++) csr[i] = header->csr[i];
+
+  cycles = header->cycles;
+  pending = header->pending;
+  timerGeneration = header->timerGeneration;
+  terminalScheduled = header->terminalScheduled;
+
+  for (uint32_t i = 0; i < header->numOfEvents; i++)
+    events.push({savedEvents[i].cycle, (int)savedEvents[i].type, savedEvents[i].generation});
+
+  // Saved characters come before anything typed since the start
+  {
+    lock_guard<mutex> lock(inputMutex);
+    input.insert(input.begin(), savedInput, savedInput + header->inputSize);
+  }
+
+  updateNextEvent();
+}
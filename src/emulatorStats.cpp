@@ -0,0 +1,46 @@
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include "../inc/emulator.h"
+
+// Host side statistics (--stats). Instructions are counted per (OC, M) pair
+// by every engine; timing a single instruction would cost more than running
+// it, so the report gives each pair's share of the executed instructions.
+
+static const char *operationNames[] = {"halt", "int", "call", "jmp", "xchg", "ari", "log", "sh", "st", "ld"};
+
+void Machine::collectStats() {
+  stats = true;
+}
+
+void Machine::printStats() {
+
+  unsigned long long instructions = 0;
+  for (unsigned long long count : opCounts) instructions += count;
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  cout << setfill(' ') << "Emulator statistics:" << endl;
+  cout << "  engine        " << engine << endl;
+  cout << "  instructions  " << dec << instructions << endl;
+  cout << "  time          " << fixed << setprecision(6) << runSeconds << " s" << endl;
+  cout << "  MIPS          " << fixed << setprecision(1) << (runSeconds > 0 ? instructions / runSeconds / 1e6 : 0) << endl;
+  cout << "  interrupts    timer " << interruptCounts[TIMER_CAUSE] << ", terminal " << interruptCounts[TERMINAL_CAUSE]
+       << ", software " << interruptCounts[SOFTWARE_CAUSE] << endl;
+  cout << "  peak RSS      " << usage.ru_maxrss << " KiB" << endl;
+
+  cout << "  instructions per operation:" << endl;
+
+  for (int code = 0; code < 256; code++) {
+    if (!opCounts[code]) continue;
+
+    unsigned OC = code >> 4;
+    cout << "    " << setw(7) << left << (OC < 10 ? operationNames[OC] : "invalid") << right
+         << "OC=" << hex << OC << " M=" << (code & LOWER_4_BITS) << dec
+         << setw(14) << opCounts[code]
+         << setw(8) << fixed << setprecision(2) << 100.0 * opCounts[code] / instructions << " %" << endl;
+  }
+
+  cout.unsetf(ios::floatfield);
+}
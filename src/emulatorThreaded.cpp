@@ -0,0 +1,282 @@
+#include "../inc/emulator.h"
+
+// Threaded engine: every (OC, M) pair has its own handler and every handler
+// ends with its own jump to the next one. GCC and Clang jump through a table of
+// label addresses (computed goto), other compilers use one dense switch.
+
+#if defined(__GNUC__)
+#define COMPUTED_GOTO
+#endif
+
+#define FETCH()                         \
+  if (cycles >= nextEvent.load(memory_order_relaxed)) \
+    serviceEvents();                    \
+  cycles++;                             \
+  ins = decode(r[pc]);                  \
+  if (!ins) {                           \
+    invalidPC();                        \
+    return;                             \
+  }                                     \
+  r[pc] += 4;                           \
+  if (stats) opCounts[ins->OC << 4 | ins->M]++;
+
+#define PUSH(value)                     \
+  r[sp] -= 4;                           \
+  memory.write32(r[sp], value);
+
+#if defined(COMPUTED_GOTO)
+#define OP(code, label)   label:
+#define NEXT()            FETCH(); goto *table[ins->op];
+#else
+#define OP(code, label)   case code:
+#define NEXT()            continue;
+#endif
+
+void Machine::runThreaded() {
+
+  unsigned *r = gpr.data();
+  unsigned *c = csr.data();
+  const Instruction *ins;
+
+#if defined(COMPUTED_GOTO)
+  static void *table[256];
+  static mutex tableMutex;
+
+  {
+    // Machines may start on several threads at once
+    lock_guard<mutex> lock(tableMutex);
+
+    if (!table[0]) {
+      for (int i = 0; i < 256; i++) table[i] = &&invalid;
+
+      table[HALT << 4]            = &&halt;
+      table[INT << 4]             = &&_int;
+      table[CALL << 4 | CALL_M1]  = &&call_m1;
+      table[CALL << 4 | CALL_M2]  = &&call_m2;
+      table[JMP << 4 | JMP_M1]    = &&jmp_m1;
+      table[JMP << 4 | JMP_M2]    = &&jmp_m2;
+      table[JMP << 4 | JMP_M3]    = &&jmp_m3;
+      table[JMP << 4 | JMP_M4]    = &&jmp_m4;
+      table[JMP << 4 | JMP_M5]    = &&jmp_m5;
+      table[JMP << 4 | JMP_M6]    = &&jmp_m6;
+      table[JMP << 4 | JMP_M7]    = &&jmp_m7;
+      table[JMP << 4 | JMP_M8]    = &&jmp_m8;
+      table[XCHG << 4]            = &&xchg;
+      table[ARI << 4 | ADD]       = &&add;
+      table[ARI << 4 | SUB]       = &&sub;
+      table[ARI << 4 | MUL]       = &&mul;
+      table[ARI << 4 | DIV]       = &&div;
+      table[LOG << 4 | NOT]       = &&_not;
+      table[LOG << 4 | AND]       = &&_and;
+      table[LOG << 4 | OR]        = &&_or;
+      table[LOG << 4 | XOR]       = &&_xor;
+      table[SH << 4 | SHL]        = &&shl;
+      table[SH << 4 | SHR]        = &&shr;
+      table[ST << 4 | ST_M1]      = &&st_m1;
+      table[ST << 4 | ST_M2]      = &&st_m2;
+      table[ST << 4 | ST_M3]      = &&st_m3;
+      table[LD << 4 | LD_M1]      = &&ld_m1;
+      table[LD << 4 | LD_M2]      = &&ld_m2;
+      table[LD << 4 | LD_M3]      = &&ld_m3;
+      table[LD << 4 | LD_M4]      = &&ld_m4;
+      table[LD << 4 | LD_M5]      = &&ld_m5;
+      table[LD << 4 | LD_M6]      = &&ld_m6;
+      table[LD << 4 | LD_M7]      = &&ld_m7;
+      table[LD << 4 | LD_M8]      = &&ld_m8;
+      table[OP_COUNTER]           = &&counter;
+      table[OP_NOP]               = &&nop;
+    }
+  }
+
+  NEXT();
+#else
+  for (;;) {
+    FETCH();
+
+    switch (ins->op) {
+#endif
+
+  // -------------------------------- CONTROL --------------------------------
+
+  OP(HALT << 4, halt)
+    _halt(*ins);
+    return;
+
+  OP(INT << 4, _int)
+    interrupt(SOFTWARE_CAUSE);
+    NEXT();
+
+  OP(CALL << 4 | CALL_M1, call_m1)
+    PUSH(r[pc]);
+    r[pc] = r[ins->A] + r[ins->B] + ins->D;
+    if (profiling) profileCall(false);
+    NEXT();
+
+  OP(CALL << 4 | CALL_M2, call_m2)
+    PUSH(r[pc]);
+    r[pc] = memory.read32(r[ins->A] + r[ins->B] + ins->D);
+    if (profiling) profileCall(false);
+    NEXT();
+
+  // --------------------------------- JUMPS ---------------------------------
+
+  OP(JMP << 4 | JMP_M1, jmp_m1)
+    r[pc] = r[ins->A] + ins->D;
+    NEXT();
+
+  OP(JMP << 4 | JMP_M2, jmp_m2)
+    if (r[ins->B] == r[ins->C]) r[pc] = r[ins->A] + ins->D;
+    NEXT();
+
+  OP(JMP << 4 | JMP_M3, jmp_m3)
+    if (r[ins->B] != r[ins->C]) r[pc] = r[ins->A] + ins->D;
+    NEXT();
+
+  OP(JMP << 4 | JMP_M4, jmp_m4)
+    if ((int)r[ins->B] - (int)r[ins->C] > 0) r[pc] = r[ins->A] + ins->D;
+    NEXT();
+
+  OP(JMP << 4 | JMP_M5, jmp_m5)
+    r[pc] = memory.read32(r[ins->A] + ins->D);
+    NEXT();
+
+  OP(JMP << 4 | JMP_M6, jmp_m6)
+    if (r[ins->B] == r[ins->C]) r[pc] = memory.read32(r[ins->A] + ins->D);
+    NEXT();
+
+  OP(JMP << 4 | JMP_M7, jmp_m7)
+    if (r[ins->B] != r[ins->C]) r[pc] = memory.read32(r[ins->A] + ins->D);
+    NEXT();
+
+  OP(JMP << 4 | JMP_M8, jmp_m8)
+    if ((int)r[ins->B] - (int)r[ins->C] > 0) r[pc] = memory.read32(r[ins->A] + ins->D);
+    NEXT();
+
+  // ---------------------------------- ALU ----------------------------------
+
+  OP(XCHG << 4, xchg) {
+    unsigned temp = r[ins->B];
+    r[ins->B] = r[ins->C];
+    r[ins->C] = temp;
+    NEXT();
+  }
+
+  OP(ARI << 4 | ADD, add)
+    r[ins->A] = r[ins->B] + r[ins->C];
+    NEXT();
+
+  OP(ARI << 4 | SUB, sub)
+    r[ins->A] = r[ins->B] - r[ins->C];
+    NEXT();
+
+  OP(ARI << 4 | MUL, mul)
+    r[ins->A] = r[ins->B] * r[ins->C];
+    NEXT();
+
+  OP(ARI << 4 | DIV, div)
+    r[ins->A] = r[ins->B] / r[ins->C];
+    NEXT();
+
+  OP(LOG << 4 | NOT, _not)
+    r[ins->A] = ~r[ins->B];
+    NEXT();
+
+  OP(LOG << 4 | AND, _and)
+    r[ins->A] = r[ins->B] & r[ins->C];
+    NEXT();
+
+  OP(LOG << 4 | OR, _or)
+    r[ins->A] = r[ins->B] | r[ins->C];
+    NEXT();
+
+  OP(LOG << 4 | XOR, _xor)
+    r[ins->A] = r[ins->B] ^ r[ins->C];
+    NEXT();
+
+  OP(SH << 4 | SHL, shl)
+    r[ins->A] = r[ins->B] << r[ins->C];
+    NEXT();
+
+  OP(SH << 4 | SHR, shr)
+    r[ins->A] = r[ins->B] >> r[ins->C];
+    NEXT();
+
+  // --------------------------------- STORE ---------------------------------
+
+  OP(ST << 4 | ST_M1, st_m1)
+    memory.write32(r[ins->A] + r[ins->B] + ins->D, r[ins->C]);
+    NEXT();
+
+  OP(ST << 4 | ST_M2, st_m2)
+    memory.write32(memory.read32(r[ins->A] + r[ins->B] + ins->D), r[ins->C]);
+    NEXT();
+
+  OP(ST << 4 | ST_M3, st_m3)
+    r[ins->A] += ins->D;
+    memory.write32(r[ins->A], r[ins->C]);
+    NEXT();
+
+  // ---------------------------------- LOAD ---------------------------------
+
+  OP(LD << 4 | LD_M1, ld_m1)
+    r[ins->A] = c[ins->B];
+    NEXT();
+
+  OP(OP_COUNTER, counter)
+    r[ins->A] = readCounter(ins->B);
+    NEXT();
+
+  OP(LD << 4 | LD_M2, ld_m2)
+    r[ins->A] = r[ins->B] + ins->D;
+    NEXT();
+
+  OP(LD << 4 | LD_M3, ld_m3)
+    r[ins->A] = memory.read32(r[ins->B] + r[ins->C] + ins->D);
+    NEXT();
+
+  OP(LD << 4 | LD_M4, ld_m4)
+    r[ins->A] = memory.read32(r[ins->B]);
+    r[ins->B] += ins->D;
+    NEXT();
+
+  // Written csr may unmask a pending interrupt
+
+  OP(LD << 4 | LD_M5, ld_m5)
+    c[ins->A] = r[ins->B];
+    updateNextEvent();
+    NEXT();
+
+  OP(LD << 4 | LD_M6, ld_m6)
+    c[ins->A] = c[ins->B] | ins->D;
+    updateNextEvent();
+    NEXT();
+
+  OP(LD << 4 | LD_M7, ld_m7)
+    c[ins->A] = memory.read32(r[ins->B] + r[ins->C] + ins->D);
+    updateNextEvent();
+    NEXT();
+
+  OP(LD << 4 | LD_M8, ld_m8)
+    c[ins->A] = memory.read32(r[ins->B]);
+    r[ins->B] += ins->D;
+    updateNextEvent();
+    NEXT();
+
+  // ---------------------------------- OTHER --------------------------------
+
+  OP(OP_NOP, nop)
+    NEXT();
+
+#if defined(COMPUTED_GOTO)
+invalid:
+#else
+    default:
+#endif
+    wrongOC(*ins);
+    return;
+
+#if !defined(COMPUTED_GOTO)
+    }
+  }
+#endif
+}
@@ -0,0 +1,171 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "../inc/trace.h"
+#include "../inc/emulator.h"
+
+// Execution trace (--trace). The machine runs the reference engine's
+// instruction path and puts a record of every instruction into a ring buffer
+// with one producer and one consumer; a writer thread encodes the records
+// (see trace.h) and writes them to the file. The machine waits only when the
+// ring is full, so tracing costs the diff of the registers and a copy of the
+// record per instruction.
+
+#define TRACE_RING_SIZE   (1 << 16) // records, power of two
+#define TRACE_BATCH_SIZE  (1 << 20) // encoded bytes written at once
+
+class TraceWriter {
+public:
+
+  TraceWriter(const string &fileName) : file(fileName, ios::binary | ios::trunc), ring(new TraceRecord[TRACE_RING_SIZE]),
+                                        head(0), tail(0), done(false) {
+    TraceHeader header = {TRACE_MAGIC, TRACE_VERSION};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    writer = thread(&TraceWriter::drain, this);
+  }
+
+  ~TraceWriter() {
+    done.store(true, memory_order_release);
+    writer.join();
+    delete[] ring;
+  }
+
+  bool failed() const { return !file; }
+
+  void put(const TraceRecord &record) {
+    size_t h = head.load(memory_order_relaxed);
+
+    while (h - tail.load(memory_order_acquire) == TRACE_RING_SIZE) this_thread::yield();
+
+    ring[h & (TRACE_RING_SIZE - 1)] = record;
+    head.store(h + 1, memory_order_release);
+  }
+
+private:
+
+  ofstream file;
+  TraceRecord *ring;
+
+  // Records [tail, head) are waiting, head is moved by the machine and tail
+  // by the writer only
+  atomic<size_t> head;
+  atomic<size_t> tail;
+  atomic<bool> done;
+  thread writer;
+
+  void drain() {
+    TraceState state;
+    vector<uint8_t> buffer(TRACE_BATCH_SIZE + TRACE_MAX_RECORD);
+    uint8_t *out = buffer.data();
+    uint8_t *full = buffer.data() + TRACE_BATCH_SIZE;
+
+    while (true) {
+      bool stopping = done.load(memory_order_acquire);
+      size_t h = head.load(memory_order_acquire);
+      size_t t = tail.load(memory_order_relaxed);
+
+      for (; t != h; t++) {
+        out = traceEncode(out, state, ring[t & (TRACE_RING_SIZE - 1)]);
+
+        if (out >= full) {
+          tail.store(t + 1, memory_order_release);
+          file.write(reinterpret_cast<const char *>(buffer.data()), out - buffer.data());
+          out = buffer.data();
+        }
+      }
+      tail.store(t, memory_order_release);
+
+      if (stopping) break;
+      if (t == h) this_thread::sleep_for(chrono::microseconds(100));
+    }
+
+    file.write(reinterpret_cast<const char *>(buffer.data()), out - buffer.data());
+    file.flush();
+  }
+};
+
+
+void Machine::trace(string fileName) {
+  tracer = new TraceWriter(fileName);
+
+  if (tracer->failed()) {
+    cout << "Can't write trace " << fileName << "!" << endl;
+    exit(-2);
+  }
+}
+
+void Machine::runTraced() {
+
+  unsigned before[NUM_OF_GPR];
+  TraceRecord record;
+
+  while (true) {
+    if (cycles >= nextEvent.load(memory_order_relaxed)) {
+      serviceEvents();
+      traceInterrupt();
+    }
+    cycles++;
+
+    const Instruction *ins = decode(gpr[pc]);
+
+    if (!ins) {
+      invalidPC();
+      break;
+    }
+
+    record.address = gpr[pc];
+    record.raw = memory.read32(gpr[pc]);
+    record.interrupt = 0;
+
+    gpr[pc] += 4;
+
+    if (stats) opCounts[ins->OC << 4 | ins->M]++;
+
+    memcpy(before, gpr.data(), sizeof(before));
+    traceWrite = false;
+
+    bool executed = (this->*ins->execute)(*ins);
+
+    record.numOfRegs = 0;
+    for (int i = 0; i < NUM_OF_GPR && record.numOfRegs < TRACE_MAX_REGS; i++) {
+      if (i == pc || gpr[i] == before[i]) continue;
+      record.regs[record.numOfRegs] = i;
+      record.values[record.numOfRegs++] = gpr[i];
+    }
+
+    record.write = traceWrite;
+    record.writeAddress = traceAddress;
+    record.writeValue = traceValue;
+
+    tracer->put(record);
+
+    // Software interrupt follows the int instruction
+    traceInterrupt();
+
+    if (!executed) break;
+  }
+
+  delete tracer;
+  tracer = nullptr;
+}
+
+// Record an interrupt taken since the last call
+void Machine::traceInterrupt() {
+  if (!tracedInterrupt) return;
+
+  // Handler starts with status and pc pushed
+  TraceRecord record = {};
+  record.address = gpr[pc];
+  record.interrupt = tracedInterrupt;
+  record.numOfRegs = 1;
+  record.regs[0] = sp;
+  record.values[0] = gpr[sp];
+  record.write = 1;
+  record.writeAddress = gpr[sp];
+  record.writeValue = memory.read32(gpr[sp]);
+  tracer->put(record);
+
+  tracedInterrupt = 0;
+}
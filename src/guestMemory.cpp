@@ -0,0 +1,231 @@
+#include "../inc/guestMemory.h"
+
+GuestMemory::GuestMemory() {
+  for (int i = 0; i < DIRECTORY_SIZE; i++) directory[i] = nullptr;
+  allocated = 0;
+  deviceStart = 0;
+  deviceWrite = nullptr;
+  deviceContext = nullptr;
+  store = nullptr;
+  storeGeneration = 0;
+
+  for (int i = 0; i < STORE_MISSES; i++) storeMisses[i] = {~0u, 0};
+}
+
+GuestMemory::~GuestMemory() {
+  for (int i = 0; i < DIRECTORY_SIZE; i++) {
+    if (!directory[i]) continue;
+
+    for (int j = 0; j < TABLE_SIZE; j++) {
+      release(&directory[i][j]);
+      delete directory[i][j].code;
+    }
+
+    delete[] directory[i];
+  }
+}
+
+GuestPage *GuestMemory::touch(unsigned address) {
+  GuestPage *&table = directory[address >> (GUEST_PAGE_BITS + TABLE_BITS)];
+
+  if (!table)
+    table = new GuestPage[TABLE_SIZE]();
+
+  GuestPage *p = &table[(address >> GUEST_PAGE_BITS) & TABLE_MASK];
+
+  // Untouched memory reads as zero
+  if (!p->data) {
+    if (store) return fromStore(address, true);
+
+    p->data = new char[GUEST_PAGE_SIZE]();
+    allocated++;
+  }
+
+  if (p->references) unshare(p);
+
+  return p;
+}
+
+// Page stops being shared, the last owner keeps the data
+void GuestMemory::unshare(GuestPage *p) {
+
+  if (p->references->load() != 1) {
+    char *copy = new char[GUEST_PAGE_SIZE];
+    memcpy(copy, p->data, GUEST_PAGE_SIZE);
+    allocated++;
+
+    // Other owners may have dropped the page in the meantime
+    release(p);
+
+    p->data = copy;
+    p->external = false;
+  }
+  else {
+    delete p->references;
+  }
+
+  p->references = nullptr;
+}
+
+void GuestMemory::release(GuestPage *p) {
+  if (p->references && p->references->fetch_sub(1) != 1) return;
+
+  if (!p->external) delete[] p->data;
+  delete p->references;
+}
+
+void GuestMemory::shareWith(GuestMemory &child) {
+  for (int i = 0; i < DIRECTORY_SIZE; i++) {
+    if (!directory[i]) continue;
+
+    if (!child.directory[i])
+      child.directory[i] = new GuestPage[TABLE_SIZE]();
+
+    for (int j = 0; j < TABLE_SIZE; j++) {
+      GuestPage &p = directory[i][j];
+      if (!p.data) continue;
+
+      if (!p.references) p.references = new std::atomic<unsigned>(1);
+      p.references->fetch_add(1);
+
+      // Decoded code belongs to one memory, the child decodes again
+      child.directory[i][j] = {p.data, nullptr, p.device, p.external, p.references, false};
+    }
+  }
+}
+
+bool GuestMemory::attach(unsigned address, char *data) {
+  GuestPage *&table = directory[address >> (GUEST_PAGE_BITS + TABLE_BITS)];
+
+  if (!table)
+    table = new GuestPage[TABLE_SIZE]();
+
+  GuestPage *p = &table[(address >> GUEST_PAGE_BITS) & TABLE_MASK];
+  if (p->data) return false;
+
+  p->data = data;
+  p->external = true;
+  return true;
+}
+
+unsigned char GuestMemory::read8(unsigned address) {
+  char *data = page(address);
+  return data ? data[address & GUEST_PAGE_MASK] : 0;
+}
+
+void GuestMemory::write8(unsigned address, unsigned char value) {
+  GuestPage *p = touch(address);
+  p->data[address & GUEST_PAGE_MASK] = value;
+
+  if (p->code) p->code->invalidate(address & GUEST_PAGE_MASK);
+}
+
+unsigned GuestMemory::pagesAllocated() {
+  return allocated;
+}
+
+std::vector<unsigned> GuestMemory::pages() {
+  std::vector<unsigned> addresses;
+
+  for (unsigned i = 0; i < DIRECTORY_SIZE; i++) {
+    if (!directory[i]) continue;
+
+    for (unsigned j = 0; j < TABLE_SIZE; j++)
+      if (directory[i][j].data)
+        addresses.push_back((i << (GUEST_PAGE_BITS + TABLE_BITS)) | (j << GUEST_PAGE_BITS));
+  }
+
+  return addresses;
+}
+
+void GuestMemory::viewOf(GuestMemory &store) {
+  this->store = &store;
+}
+
+// Page of the store becomes a page of this view (nullptr if the store doesn't
+// have the page and create is false)
+GuestPage *GuestMemory::fromStore(unsigned address, bool create) {
+  unsigned number = address >> GUEST_PAGE_BITS;
+  StoreMiss &miss = storeMisses[number & (STORE_MISSES - 1)];
+
+  if (!create && miss.page == number && miss.generation == store->storeGeneration.load())
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(store->storeMutex);
+
+  bool missing = !store->entry(address);
+
+  if (missing && !create) {
+    miss = {number, store->storeGeneration.load()};
+    return nullptr;
+  }
+
+  GuestPage *shared = create ? store->touch(address) : store->entry(address);
+  if (missing) store->storeGeneration++;
+
+  GuestPage *&table = directory[address >> (GUEST_PAGE_BITS + TABLE_BITS)];
+
+  if (!table)
+    table = new GuestPage[TABLE_SIZE]();
+
+  GuestPage *p = &table[(address >> GUEST_PAGE_BITS) & TABLE_MASK];
+  p->data = shared->data;
+  p->device = shared->device;
+  p->external = true;
+  p->concurrent = true;
+
+  return p;
+}
+
+void GuestMemory::mapDevices(unsigned start, DeviceWrite write, void *context) {
+  deviceStart = start;
+  deviceWrite = write;
+  deviceContext = context;
+
+  for (unsigned address = start & ~GUEST_PAGE_MASK; ; address += GUEST_PAGE_SIZE) {
+    touch(address)->device = true;
+    if (address + GUEST_PAGE_SIZE == 0) break;
+  }
+}
+
+// Unaligned accesses and accesses to untouched pages go byte by byte (a word
+// may also cross a page boundary)
+
+unsigned GuestMemory::readSlow(unsigned address) {
+  GuestPage *p = entry(address);
+
+  if (p && p->concurrent && (address & 0x3) == 0)
+    return __atomic_load_n(reinterpret_cast<unsigned *>(p->data + (address & GUEST_PAGE_MASK)), __ATOMIC_SEQ_CST);
+
+  unsigned value = 0;
+
+  for (int i = 3; i >= 0; i--) {
+    value <<= 8;
+    value |= read8(address + i);
+  }
+
+  return value;
+}
+
+void GuestMemory::writeSlow(unsigned address, unsigned value) {
+  // View takes the page from the store before the first write, so it is written atomically
+  GuestPage *p = store ? touch(address) : entry(address);
+
+  // Aligned write to a shared or concurrent page or a page holding code or memory
+  // mapped registers
+  if (p && (address & 0x3) == 0) {
+    if (p->references) unshare(p);
+
+    if (p->concurrent)
+      __atomic_store_n(reinterpret_cast<unsigned *>(p->data + (address & GUEST_PAGE_MASK)), value, __ATOMIC_SEQ_CST);
+    else
+      memcpy(p->data + (address & GUEST_PAGE_MASK), &value, sizeof(value));
+
+    if (p->code) p->code->invalidate(address & GUEST_PAGE_MASK);
+    if (p->device && address >= deviceStart) deviceWrite(deviceContext, address, value);
+    return;
+  }
+
+  for (int i = 0; i < 4; i++)
+    write8(address + i, (value >> (i * 8)) & 0xFF);
+}
@@ -1,82 +1,257 @@
 #include "../inc/linker.h"
+#include "../inc/image.h"
 #include <iostream>
 #include <algorithm>
-#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 
 // ---------------------------- STATIC VARIABLES ----------------------------
 
 vector<Linker::PlaceSection *> Linker::placeSections;
 vector<MyElf *> Linker::elfFiles;
-Linker::Section *Linker::firstSection;
-Linker::Section *Linker::lastSection;
+vector<Linker::Group *> Linker::groups;
+unordered_map<string_view, Linker::Group *> Linker::groupIndex;
+map<unsigned, Linker::Group *> Linker::placedGroups;
+vector<Linker::Section> Linker::layout;
+unordered_map<string_view, Linker::GlobalSymbol> Linker::globalSymbols;
+StageTimer Linker::timer;
+
+// -------------------------------- WORKERS ---------------------------------
+
+// Run task for every index on all cores (tasks must not share written data)
+void Linker::parallelFor(size_t count, function<void(size_t)> task)
+{
+  atomic<size_t> next(0);
+
+  auto worker = [&]()
+  {
+    for (size_t i = next++; i < count; i = next++)
+      task(i);
+  };
+
+  size_t numOfThreads = min<size_t>(max(1u, thread::hardware_concurrency()), count);
+
+  vector<thread> threads;
+  for (size_t i = 1; i < numOfThreads; i++)
+    threads.emplace_back(worker);
+
+  worker();
+
+  for (thread &t : threads)
+    t.join();
+}
 
 // ----------------------------- LOAD ELF FILES -----------------------------
 
 bool Linker::loadElfFiles(vector<string> inputFiles)
 {
-  for (string inputFileName : inputFiles)
+  // Files are independent until symbols are resolved, so they are loaded on
+  // all cores. Every file has its own slot, which keeps command line order.
+  vector<MyElf *> loaded(inputFiles.size(), nullptr);
+
+  parallelFor(inputFiles.size(), [&](size_t i)
+              { loaded[i] = MyElf::load(inputFiles[i]); });
+
+  bool valid = true;
+  for (MyElf *myElf : loaded)
   {
-    FILE *inputFile = fopen(inputFileName.c_str(), "r");
-    if (!inputFile) return false;
+    if (myElf)
+      elfFiles.push_back(myElf);
+    else
+      valid = false;
+  }
+
+  return valid && elfFiles.size();
+}
 
-    elfFiles.push_back(MyElf::read(inputFile));
-    
-    fclose(inputFile);
+// ------------------------------- HEX OUTPUT -------------------------------
+
+// Output is formatted into a large buffer, which is written with few system calls
+
+#define OUTPUT_BUFFER_SIZE  (1 << 20)
+#define LINE_SIZE           (1 + 9 + 8 * 3) // new line, "aaaaaaaa:" and 8 bytes " xx"
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static char *putAddress(char *p, unsigned address)
+{
+  for (int i = 7; i >= 0; i--, address >>= 4)
+    p[i] = hexDigits[address & 0xF];
+
+  p[8] = ':';
+  return p + 9;
+}
+
+static char *putByte(char *p, unsigned char byte)
+{
+  p[0] = ' ';
+  p[1] = hexDigits[byte >> 4];
+  p[2] = hexDigits[byte & 0xF];
+  return p + 3;
+}
+
+static bool writeAll(int fd, const char *data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t written = write(fd, data, size);
+    if (written < 0)
+      return false;
+
+    data += written;
+    size -= written;
   }
 
-  return elfFiles.size();
+  return true;
 }
 
 void Linker::print(string outputFileName)
 {
-  ofstream outputFile;
-  outputFile.open(outputFileName, ofstream::out);
+  int fd = open(outputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    cout << "Can't open output file " << outputFileName << "!" << endl;
+    exit(-5);
+  }
+
+  vector<char> buffer(OUTPUT_BUFFER_SIZE);
+  char *p = buffer.data();
+  char *limit = buffer.data() + buffer.size() - LINE_SIZE; // a whole line always fits
+  bool ok = true;
 
-  int bytesPrinted = 0;
+  int bytesInLine = 0;  // Bytes printed in the current line
+  unsigned lineAddr = 0; // Address of the current line
+  bool firstLine = true;
 
-  for (Section *s = firstSection; s; s = s->next)
+  for (Section &s : layout)
   {
-    MyElf::Section *section = s->section;
-    unsigned address = s->startAddr; // Starting address of a section
-    unsigned prevAddr;               // Prevoiusly printed address
-
-    // Check if last section output was aligned with 8
-    if (bytesPrinted % 8 != 0)
-      // Check if beginning of a new section is rigth behined end of a previous one
-      if (address != prevAddr + 4)
-        // If it is not, fill end of the line with zeros
-        while (bytesPrinted % 8 != 0)
-        {
-          outputFile << " 00";
-          bytesPrinted++;
-        }
-      else
-        // If it is, set beginning of a new section 4 locations further
-        address += 4;
+    MyElf::Section *section = s.section;
+    unsigned address = s.startAddr; // Starting address of a section
 
-    // Start of a new section
-    for (int i = 0; i < section->memory.size(); i++)
+    // If a new section doesn't continue right behind the end of a previous one,
+    // fill end of the line with zeros
+    if (bytesInLine != 0 && address != lineAddr + bytesInLine)
     {
-      if (bytesPrinted % 8 == 0)
+      for (; bytesInLine < 8; bytesInLine++)
+        p = putByte(p, 0);
+      bytesInLine = 0;
+    }
+
+    for (int i = 0; i < section->size; i++)
+    {
+      if (bytesInLine == 0)
       {
+        if (p > limit)
+        {
+          ok = ok && writeAll(fd, buffer.data(), p - buffer.data());
+          p = buffer.data();
+        }
 
-        if (!(s == firstSection && i == 0))
-          outputFile << endl;
+        if (!firstLine)
+          *p++ = '\n';
+        firstLine = false;
 
-        outputFile << setw(8) << setfill('0') << hex << address << ':';
-        prevAddr = address;
-        address += 8;
+        lineAddr = address + i;
+        p = putAddress(p, lineAddr);
       }
 
-      outputFile << " " << setw(2) << setfill('0') << hex << (unsigned)((unsigned char)section->memory[i]);
-      bytesPrinted++;
+      p = putByte(p, section->data[i]);
+
+      if (++bytesInLine == 8)
+        bytesInLine = 0;
+    }
+  }
+
+  for (; bytesInLine != 0 && bytesInLine < 8; bytesInLine++)
+    p = putByte(p, 0);
+
+  ok = ok && writeAll(fd, buffer.data(), p - buffer.data());
+
+  if (close(fd) < 0 || !ok)
+  {
+    cout << "Can't write output file " << outputFileName << "!" << endl;
+    exit(-5);
+  }
+}
+
+// ------------------------------ BINARY OUTPUT -----------------------------
+
+// Sections that follow each other without a gap form one segment
+void Linker::printBinary(string outputFileName)
+{
+  int fd = open(outputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    cout << "Can't open output file " << outputFileName << "!" << endl;
+    exit(-5);
+  }
+
+  vector<SegmentHeader> segments;
+  vector<size_t> firstSections; // index in layout of the first section of every segment
+
+  for (size_t i = 0; i < layout.size(); i++)
+  {
+    Section &s = layout[i];
+    if (s.startAddr == s.endAddr)
+      continue;
+
+    SegmentHeader *last = segments.empty() ? nullptr : &segments.back();
+
+    if (last && last->address + last->size == s.startAddr)
+    {
+      last->size += s.endAddr - s.startAddr;
+      continue;
     }
+
+    segments.push_back({s.startAddr, s.endAddr - s.startAddr, 0, 0});
+    firstSections.push_back(i);
+  }
+
+  // Segment bytes start on the same place in a page as the segment in memory
+  unsigned long long offset = sizeof(ImageHeader) + segments.size() * sizeof(SegmentHeader);
+
+  for (SegmentHeader &segment : segments)
+  {
+    offset += (segment.address % IMAGE_PAGE_SIZE + IMAGE_PAGE_SIZE - offset % IMAGE_PAGE_SIZE) % IMAGE_PAGE_SIZE;
+    segment.offset = offset;
+    offset += segment.size;
   }
 
-  while (bytesPrinted++ % 8 != 0)
-    outputFile << " 00";
+  ImageHeader header = {IMAGE_MAGIC, IMAGE_VERSION, (uint32_t)segments.size(), 0};
+
+  bool ok = offset <= UINT32_MAX;
+  ok = ok && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+  ok = ok && pwrite(fd, segments.data(), segments.size() * sizeof(SegmentHeader), sizeof(header)) ==
+                 (ssize_t)(segments.size() * sizeof(SegmentHeader));
 
-  outputFile.close();
+  // Section contents are written where they belong, gaps between segments stay zero
+  for (size_t i = 0; i < segments.size() && ok; i++)
+  {
+    // Last segment may end at the end of memory (2^32)
+    uint64_t end = (uint64_t)segments[i].address + segments[i].size;
+
+    for (size_t j = firstSections[i]; j < layout.size() && layout[j].startAddr < end; j++)
+    {
+      Section &s = layout[j];
+      if (s.startAddr == s.endAddr)
+        continue;
+
+      ssize_t size = s.endAddr - s.startAddr;
+      ok = pwrite(fd, s.section->data, size, segments[i].offset + (s.startAddr - segments[i].address)) == size;
+      if (!ok)
+        break;
+    }
+  }
+
+  ok = ok && ftruncate(fd, offset) == 0;
+
+  if (close(fd) < 0 || !ok)
+  {
+    cout << "Can't write output file " << outputFileName << "!" << endl;
+    exit(-5);
+  }
 }
 
 void Linker::cleanup()
@@ -87,12 +262,6 @@ void Linker::cleanup()
   for (MyElf *myElf : elfFiles)
     delete myElf;
 
-  Section *s = firstSection->next, *p = firstSection;
-  while (p)
-  {
-    delete p;
-    p = s;
-    if (s)
-      s = s->next;
-  }
+  for (Group *group : groups)
+    delete group;
 }
@@ -3,6 +3,8 @@
 
 vector<string> inputFiles;
 string outputFile = "outputFile.hex";
+bool binaryOutput = false;
+string mapFile;
 
 void loadArguments(int argc, char **argv);
 
@@ -12,6 +14,8 @@ int main(int argc, char **argv)
 
   loadArguments(argc, argv);
 
+  Linker::timer.start();
+
   // ----------------------------- Load files into MyElf objects -----------------------------
 
   if (!Linker::loadElfFiles(inputFiles))
@@ -20,6 +24,8 @@ int main(int argc, char **argv)
     return -1;
   }
 
+  Linker::timer.done("load");
+
   // --------------------------------- Arrange sections order ---------------------------------
 
   if (!Linker::aragneSections())
@@ -28,17 +34,31 @@ int main(int argc, char **argv)
     return -2;
   }
 
+  Linker::timer.done("sections");
+
   // -------------------------------- Calculate symbol values --------------------------------
 
   Linker::calculateSymbolValues();
 
+  Linker::timer.done("symbols");
+
   // ---------------------------------- Process relovcations ----------------------------------
 
   Linker::processRelocations();
 
+  Linker::timer.done("relocations");
+
   // --------------------------------- Print into outputFile ---------------------------------
 
-  Linker::print(outputFile);
+  if (binaryOutput)
+    Linker::printBinary(outputFile);
+  else
+    Linker::print(outputFile);
+
+  if (!mapFile.empty())
+    Linker::printMap(mapFile);
+
+  Linker::timer.done("print");
 
   // ----------------------------------------- Clean -----------------------------------------
 
@@ -59,6 +79,7 @@ void loadArguments(int argc, char **argv)
   }
 
   bool hexOptionFound = false;
+  bool binOptionFound = false;
 
   for (int i = 1; i < argc; i++)
   {
@@ -68,6 +89,10 @@ void loadArguments(int argc, char **argv)
     {
       hexOptionFound = true;
     }
+    else if (arg == "-bin")
+    {
+      binOptionFound = true;
+    }
     else if (arg.find("-place=") == 0)
     {
       string placeArg = arg.substr(7); // Extract the substring after "-place="
@@ -88,6 +113,14 @@ void loadArguments(int argc, char **argv)
         Linker::placeSections.push_back(section);
       }
     }
+    else if (arg == "-time")
+    {
+      Linker::timer.enabled = true;
+    }
+    else if (arg.find("-map=") == 0)
+    {
+      mapFile = arg.substr(5);
+    }
     else if (arg == "-o" && i + 1 < argc)
     {
       outputFile = argv[++i];
@@ -98,9 +131,11 @@ void loadArguments(int argc, char **argv)
     }
   }
 
-  if (!hexOptionFound)
+  if (hexOptionFound == binOptionFound)
   {
-    cout << "Error: -hex argument is required.\n";
+    cout << "Error: either -hex or -bin argument is required.\n";
     exit(-1);
   }
+
+  binaryOutput = binOptionFound;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "../inc/linker.h"
+#include "../inc/symbolMap.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// String as a JSON string literal (names are identifiers, but section names
+// may hold anything the assembler accepts)
+static string jsonString(string_view s)
+{
+  stringstream ss;
+  ss << '"';
+  for (unsigned char c : s)
+  {
+    if (c == '"' || c == '\\')
+      ss << '\\' << c;
+    else if (c < 0x20)
+      ss << "\\u" << hex << setw(4) << setfill('0') << (unsigned)c;
+    else
+      ss << c;
+  }
+  ss << '"';
+  return ss.str();
+}
+
+static string jsonAddress(unsigned address)
+{
+  stringstream ss;
+  ss << "\"0x" << hex << setw(8) << setfill('0') << address << '"';
+  return ss.str();
+}
+
+// Write final addresses of output sections and global symbols, both as a
+// binary map (read with SymbolMap) and as JSON in mapFileName.json
+void Linker::printMap(string mapFileName)
+{
+  // Empty sections hold no address, and one sharing its start address with
+  // another section would hide it from SymbolMap::section
+  vector<Group *> sections;
+  for (Group *group : groups)
+  {
+    if (group->size != 0)
+      sections.push_back(group);
+  }
+
+  sort(sections.begin(), sections.end(), [](Group *a, Group *b)
+       { return a->startAddr < b->startAddr; });
+
+  vector<pair<unsigned, string_view>> symbols;
+  for (auto &symbol : globalSymbols)
+    symbols.push_back({(unsigned)symbol.second.value, symbol.first});
+
+  sort(symbols.begin(), symbols.end());
+
+  // Binary map
+
+  string strings;
+  vector<SectionMapRecord> sectionRecords;
+  vector<SymbolMapRecord> records;
+
+  for (Group *group : sections)
+  {
+    sectionRecords.push_back({group->startAddr, (uint32_t)(group->startAddr + group->size), (uint32_t)strings.size()});
+    strings += group->name;
+    strings += '\0';
+  }
+
+  for (auto &symbol : symbols)
+  {
+    records.push_back({symbol.first, (uint32_t)strings.size()});
+    strings += symbol.second;
+    strings += '\0';
+  }
+
+  SymbolMapHeader header = {SYMBOL_MAP_MAGIC, SYMBOL_MAP_VERSION, (uint32_t)sectionRecords.size(),
+                            (uint32_t)records.size(), (uint32_t)strings.size()};
+
+  ofstream mapFile(mapFileName, ios::binary | ios::trunc);
+  mapFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  mapFile.write(reinterpret_cast<const char *>(sectionRecords.data()), sectionRecords.size() * sizeof(SectionMapRecord));
+  mapFile.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SymbolMapRecord));
+  mapFile.write(strings.data(), strings.size());
+  mapFile.close();
+
+  // JSON map
+
+  ofstream jsonFile(mapFileName + ".json", ios::trunc);
+
+  jsonFile << "{\n  \"sections\": [";
+  for (size_t i = 0; i < sections.size(); i++)
+    jsonFile << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(sections[i]->name)
+             << ", \"start\": " << jsonAddress(sections[i]->startAddr)
+             << ", \"end\": " << jsonAddress(sections[i]->startAddr + sections[i]->size) << "}";
+
+  jsonFile << "\n  ],\n  \"symbols\": [";
+  for (size_t i = 0; i < symbols.size(); i++)
+    jsonFile << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(symbols[i].second)
+             << ", \"address\": " << jsonAddress(symbols[i].first) << "}";
+
+  jsonFile << "\n  ]\n}\n";
+  jsonFile.close();
+
+  if (!mapFile || !jsonFile)
+  {
+    cout << "Can't write map file " << mapFileName << "!" << endl;
+    exit(-5);
+  }
+}
@@ -7,27 +7,41 @@ char getByte(int value, int byteIndex)
 
 void Linker::processRelocations()
 {
+  // Every relocation table patches its own section, so tables are processed in parallel
+  struct Task
+  {
+    MyElf *myElf;
+    MyElf::RelocationTable *rt;
+  };
 
+  vector<Task> tasks;
   for (MyElf *myElf : elfFiles)
   {
-    for (MyElf::RelocationTable *rt : myElf->relocationTables)
+    for (MyElf::RelocationTable &rt : myElf->relocationTables)
+      tasks.push_back({myElf, &rt});
+  }
+
+  parallelFor(tasks.size(), [&](size_t t)
+  {
+    MyElf *myElf = tasks[t].myElf;
+    MyElf::RelocationTable &rt = *tasks[t].rt;
+
+    MyElf::Section *sec = myElf->findSection(rt.sectionId);
+    int secValue = myElf->symbolTable[rt.sectionId].value;
+
+    for (MyElf::Relocation &rel : rt.relocations)
     {
-      for (MyElf::Relocation *rel : rt->relocations)
-      {
-        MyElf::Section *sec = myElf->findSection(rt->sectionId);
-        int symValue = myElf->symbolTable[rel->symbolId]->value;
-        int offset = rel->offset;
-        MyElf::RelocationTypes type = rel->type;
-        int secValue = myElf->symbolTable[rt->sectionId]->value;
-        int addend = rel->addend;
+      int symValue = myElf->symbolTable[rel.symbolId].value;
+      int offset = rel.offset;
+      MyElf::RelocationTypes type = rel.type;
+      int addend = rel.addend;
 
-        for (int i = 0; i < 4; i++)
-        {
-          int byteAbs = getByte(symValue + addend, i);
-          int byteRel = getByte(symValue - (secValue + offset) + addend, i);
-          sec->memory[offset + i] = type == MyElf::ABSOLUTE ? byteAbs : byteRel;
-        }
+      for (int i = 0; i < 4; i++)
+      {
+        int byteAbs = getByte(symValue + addend, i);
+        int byteRel = getByte(symValue - (secValue + offset) + addend, i);
+        sec->data[offset + i] = type == MyElf::ABSOLUTE ? byteAbs : byteRel;
       }
     }
-  }
-}
\ No newline at end of file
+  });
+}
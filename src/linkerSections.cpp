@@ -4,6 +4,25 @@
 
 bool Linker::aragneSections()
 {
+  // Group sections of all files by name
+  for (MyElf *myElf : elfFiles)
+  {
+    for (MyElf::Section &section : myElf->sections)
+    {
+      string_view name = myElf->names.name(section.sectionNameId);
+      Group *&group = groupIndex[name];
+
+      if (!group)
+      {
+        group = new Group(string(name));
+        groups.push_back(group);
+      }
+
+      group->sections.push_back(&section);
+      group->size += section.size;
+    }
+  }
+
   // Sort sections with place option
   sort(placeSections.begin(), placeSections.end(), [&](PlaceSection *s1, PlaceSection *s2)
        { return s1->address < s2->address; });
@@ -11,112 +30,83 @@ bool Linker::aragneSections()
   // Sections with place option
   for (PlaceSection *ps : placeSections)
   {
-    MyElf::Section *section = findSection(ps->name);
+    auto g = groupIndex.find(ps->name);
 
-    if (!section)
+    if (g == groupIndex.end() || !placeGroup(g->second, ps->address))
       return false;
-
-    section->loaded = true;
-    Section *s = new Section(section, ps->address);
-
-    if (!putSection(s))
-      return false;
-
-    // Update section value in symbol table
-    updateSectionValue(s);
   }
 
-  // Other sections
-  for (MyElf *myElf : elfFiles)
+  // Other sections follow the last section with place option
+  unsigned long long address = 0;
+
+  if (!placedGroups.empty())
   {
-    for (MyElf::Section *section : myElf->sections)
-    {
-      if (!section->loaded)
-      {
-        section->loaded = true;
-        Section *s = new Section(section, 0);
-        putSection(s);
-        updateSectionValue(s);
-      }
-    }
+    Group *last = placedGroups.rbegin()->second;
+    address = last->startAddr + last->size;
   }
 
-  return true;
-}
-
+  vector<Group *> ordered;
+  for (auto &p : placedGroups)
+    ordered.push_back(p.second);
 
-MyElf::Section *Linker::findSection(string name)
-{
-  for (MyElf *myElf : elfFiles)
+  for (Group *group : groups)
   {
-    for (MyElf::Section *section : myElf->sections)
-    {
-      if (name == section->sectionName)
-      {
-        return section;
-      }
-    }
+    if (group->placed)
+      continue;
+
+    group->startAddr = address;
+    address += group->size;
+    ordered.push_back(group);
   }
-  return nullptr;
-}
 
+  // Memory is 32 bit
+  if (address > 1ULL << 32)
+    return false;
 
-bool Linker::putSection(Section *section)
-{
-  if (!firstSection)
+  // Final addresses, assigned once
+  for (Group *group : ordered)
   {
-    firstSection = lastSection = section;
-    section->next = section->prev = nullptr;
-  }
-  else
-  {
-    // Check for overlapping (for sections with place option)
-    if (lastSection->endAddr > section->startAddr && section->startAddr != 0)
-      return false;
+    unsigned start = group->startAddr;
 
-    // Chech if section with same name was already loaded
-    for (Section *beforeSection = firstSection; beforeSection->next; beforeSection = beforeSection->next)
+    for (MyElf::Section *section : group->sections)
     {
-      if (beforeSection->section->sectionName == section->section->sectionName)
-      {
+      layout.push_back(Section(section, start));
+      updateSectionValue(&layout.back());
+      start += section->size;
+    }
+  }
 
-        section->next = beforeSection->next;
-        section->prev = beforeSection->next->prev;
-        beforeSection->next = section;
-        section->next->prev = section;
+  return true;
+}
 
-        // Set start address
-        section->startAddr = section->prev->endAddr;
 
-        // Set end address
-        section->endAddr = section->startAddr + section->section->size;
+// Put group on the address if it doesn't overlap any other group with place option
+bool Linker::placeGroup(Group *group, unsigned address)
+{
+  if (group->placed)
+    return false;
 
-        // Update following section addresses
-        for (Section *s = section->next; s; s = s->next)
-        {
-          s->startAddr += section->section->size;
-          s->endAddr += section->section->size;
+  unsigned long long end = (unsigned long long)address + group->size;
 
-          // Update in symbol tables
-          updateSectionValue(s);
-        }
+  if (end > 1ULL << 32)
+    return false;
 
-        return true;
-      }
-    }
+  // Only neighbours in address order can overlap (even an empty group can't share start address)
+  auto next = placedGroups.lower_bound(address);
 
-    lastSection->next = section;
-    section->prev = lastSection;
-    lastSection = section;
-    section->next = nullptr;
+  if (next != placedGroups.end() && (next->first < end || next->first == address))
+    return false;
 
-    // Set start address (for non-place sections)
-    if (section->startAddr == 0)
-      section->startAddr = section->prev->endAddr;
+  if (next != placedGroups.begin())
+  {
+    Group *before = prev(next)->second;
+    if (before->startAddr + before->size > address)
+      return false;
   }
 
-  // Set end addres
-  section->endAddr = section->startAddr + section->section->size;
+  group->startAddr = address;
+  group->placed = true;
+  placedGroups[address] = group;
 
   return true;
 }
@@ -125,5 +115,5 @@ bool Linker::putSection(Section *section)
 void Linker::updateSectionValue(Section *sec)
 {
   int sectionId = sec->section->secId;
-  sec->section->myElf->symbolTable[sectionId]->value = sec->startAddr;
-}
\ No newline at end of file
+  sec->section->myElf->symbolTable[sectionId].value = sec->startAddr;
+}
@@ -29,18 +29,20 @@ void MyElf::print()
   // Print horizontal line
   outputFile << setfill('-') << setw(6 * colWidth) << "-" << setfill(' ') << endl;
 
+  vector<int> ids = exportedSymbolIds();
+
   // Iterate over the symbolTable and print each Symbol
   for (int i = 0; i < symbolTable.size(); i++)
   {
-    Symbol *symbol = symbolTable[i];
-    if (!symbol->isSection && !symbol->isGlobal)
+    const Symbol &symbol = symbolTable[i];
+    if (ids[i] == -1)
       continue; // Local symbols should not be in ELF symbol table
-    outputFile << setw(2) << i
-               << setw(colWidth) << symbol->name
-               << setw(colWidth) << symbol->value
-               << setw(colWidth) << (symbol->isGlobal ? "global" : "local")
-               << setw(colWidth) << (symbol->isSection ? "section" : "symbol")
-               << setw(colWidth) << symbol->sectionId << endl;
+    outputFile << setw(2) << ids[i]
+               << setw(colWidth) << names.name(symbol.nameId)
+               << setw(colWidth) << symbol.value
+               << setw(colWidth) << (symbol.isGlobal ? "global" : "local")
+               << setw(colWidth) << (symbol.isSection ? "section" : "symbol")
+               << setw(colWidth) << symbol.sectionId << endl;
   }
 
   outputFile.flush();
@@ -52,9 +54,9 @@ void MyElf::print()
   outputFile << "RELOCATION TABLES" << endl
              << endl;
 
-  for (const RelocationTable *relocationTable : relocationTables)
+  for (const RelocationTable &relocationTable : relocationTables)
   {
-    outputFile << "Section: " << relocationTable->sectionName << endl;
+    outputFile << "Section: " << names.name(relocationTable.sectionNameId) << endl;
 
     outputFile << setw(4) << "Offset"
                << setw(colWidth) << "Type"
@@ -63,13 +65,12 @@ void MyElf::print()
 
     outputFile << setfill('-') << setw(4 * colWidth) << "-" << setfill(' ') << endl;
 
-    for (int i = 0; i < relocationTable->relocations.size(); i++)
+    for (const Relocation &relocation : relocationTable.relocations)
     {
-      Relocation *relocation = relocationTable->relocations[i];
-      outputFile << setw(5) << relocation->offset
-                 << setw(colWidth + 1) << (relocation->type == RELATIVE ? "RELATIVE" : "ABSOLUTE")
-                 << setw(colWidth) << relocation->symbolId
-                 << setw(colWidth) << relocation->addend << endl;
+      outputFile << setw(5) << relocation.offset
+                 << setw(colWidth + 1) << (relocation.type == RELATIVE ? "RELATIVE" : "ABSOLUTE")
+                 << setw(colWidth) << ids[relocation.symbolId]
+                 << setw(colWidth) << relocation.addend << endl;
     }
 
     outputFile.flush();
@@ -86,11 +87,12 @@ void MyElf::print()
 
   const int bytesPerRow = 8;
 
-  for (const Section *section : sections)
+  for (const Section &s : sections)
   {
+    const Section *section = &s;
     if (section->secId == 0)
       continue;
-    outputFile << "Section: " << section->sectionName << endl;
+    outputFile << "Section: " << names.name(section->sectionNameId) << endl;
 
     // Print memory vector
     int memorySize = section->memory.size();
@@ -135,13 +137,15 @@ void MyElf::print()
 // Retrun symbol id by name (if name doesn't exist in symbol table return -1)
 int MyElf::symbolId(char *symbol)
 {
-  for (int i = 0; i < symbolTable.size(); i++)
-  {
-    if (symbol == symbolTable[i]->name)
-      return i;
-  }
+  return symbolIndex.find(names.find(symbol));
+}
 
-  return -1;
+
+// Append symbol to symbol table and index it by name
+void MyElf::addSymbol(const Symbol &symbol)
+{
+  symbolIndex.insert(symbol.nameId, symbolTable.size());
+  symbolTable.push_back(symbol);
 }
 
 
@@ -150,7 +154,7 @@ int MyElf::secRelTabId(int secId)
 {
   for (int i = 0; i < relocationTables.size(); i++)
   {
-    if (relocationTables[i]->sectionId == secId)
+    if (relocationTables[i].sectionId == secId)
       return i;
   }
   return -1;
@@ -160,10 +164,10 @@ int MyElf::secRelTabId(int secId)
 // Return pointer to the section found by id
 MyElf::Section *MyElf::findSection(int id)
 {
-  for (Section *s : sections)
+  for (Section &s : sections)
   {
-    if (s->secId == id)
-      return s;
+    if (s.secId == id)
+      return &s;
   }
   return nullptr;
 }
@@ -215,7 +219,7 @@ void MyElf::loadSymbolTable(FILE *inputFile, MyElf *myElf)
     bool isGlobal = (strcmp(binding, "global") == 0);
     bool isSection = (strcmp(type, "section") == 0);
 
-    myElf->symbolTable.push_back(new Symbol(name, value, isGlobal, isSection, sectionId));
+    myElf->addSymbol(Symbol(myElf->names.intern(name), value, isGlobal, isSection, sectionId));
   }
 }
 
@@ -250,7 +254,7 @@ void MyElf::loadRelocationTables(FILE *inputFile, MyElf *myElf)
     }
 
     // Create a new relocation table
-    RelocationTable *relocationTable = new RelocationTable(sectionId, sectionName);
+    RelocationTable relocationTable(sectionId, myElf->names.find(sectionName));
 
     // Read the table header
     fgets(line, sizeof(line), inputFile);
@@ -269,10 +273,10 @@ void MyElf::loadRelocationTables(FILE *inputFile, MyElf *myElf)
 
       RelocationTypes relocationType = (strcmp(type, "ABSOLUTE") == 0) ? ABSOLUTE : RELATIVE;
 
-      relocationTable->relocations.push_back(new Relocation(offset, relocationType, symbolId, addend));
+      relocationTable.relocations.emplace_back(offset, relocationType, symbolId, addend);
     }
 
-    myElf->relocationTables.push_back(relocationTable);
+    myElf->relocationTables.push_back(move(relocationTable));
   }
 }
 
@@ -302,8 +306,9 @@ void MyElf::loadSectionsContent(FILE *inputFile, MyElf *myElf)
       continue;
     }
 
-    // Create a new section
-    Section *section = new Section(sectionId, sectionName);
+    // Create a new section (moving it later keeps its memory buffer, so data stays valid)
+    myElf->sections.emplace_back(sectionId, myElf->names.find(sectionName));
+    Section *section = &myElf->sections.back();
     section->myElf = myElf;
 
     // Read the memory content
@@ -322,6 +327,6 @@ void MyElf::loadSectionsContent(FILE *inputFile, MyElf *myElf)
     }
 
     section->size = section->memory.size();
-    myElf->sections.push_back(section);
+    section->data = section->memory.data();
   }
 }
@@ -0,0 +1,287 @@
+#include "../inc/myElf.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Size rounded up to the 8 byte boundary
+static uint32_t align8(uint32_t size)
+{
+  return (size + 7) & ~7u;
+}
+
+
+// Symbol id in the object file for every symbol (-1 for local symbols, which are not exported)
+vector<int> MyElf::exportedSymbolIds()
+{
+  vector<int> ids(symbolTable.size(), -1);
+
+  int next = 0;
+  for (size_t i = 0; i < symbolTable.size(); i++)
+  {
+    if (symbolTable[i].isSection || symbolTable[i].isGlobal)
+      ids[i] = next++;
+  }
+
+  return ids;
+}
+
+
+// Write binary ELF file (assembler's output, linker's input)
+void MyElf::write()
+{
+  vector<int> ids = exportedSymbolIds();
+
+  // Names are null terminated strings in the string table
+  string strings;
+  auto addString = [&strings, this](int nameId)
+  {
+    uint32_t offset = strings.size();
+    strings += names.name(nameId);
+    strings += '\0';
+    return offset;
+  };
+
+  // -------------------------------- Symbol table --------------------------------
+
+  vector<SymbolRecord> symbols;
+  for (size_t i = 0; i < symbolTable.size(); i++)
+  {
+    if (ids[i] == -1)
+      continue;
+
+    const Symbol &symbol = symbolTable[i];
+    symbols.push_back({addString(symbol.nameId), symbol.value, symbol.sectionId,
+                       symbol.isGlobal, symbol.isSection, 0});
+  }
+
+  // ------------------------------ Relocation tables ------------------------------
+
+  vector<RelocationTableRecord> tables;
+  vector<RelocationRecord> relocations;
+  for (const RelocationTable &relocationTable : relocationTables)
+  {
+    tables.push_back({relocationTable.sectionId, addString(relocationTable.sectionNameId),
+                      (uint32_t)relocationTable.relocations.size(), 0});
+
+    for (const Relocation &relocation : relocationTable.relocations)
+      relocations.push_back({relocation.offset, relocation.type, ids[relocation.symbolId], relocation.addend});
+  }
+
+  // ------------------------------ Sections content ------------------------------
+
+  vector<Section *> contents;
+  for (Section &section : sections)
+  {
+    if (section.secId != 0)
+      contents.push_back(&section);
+  }
+
+  vector<SectionRecord> sectionRecords;
+  for (Section *section : contents)
+    sectionRecords.push_back({section->secId, addString(section->sectionNameId), 0,
+                              (uint32_t)(section->memory.size() + section->literalPool.size() * sizeof(int))});
+
+  strings.resize(align8(strings.size()), '\0');
+
+  // Contents follow the tables
+  uint32_t offset = sizeof(FileHeader) + strings.size() + symbols.size() * sizeof(SymbolRecord) +
+                    tables.size() * sizeof(RelocationTableRecord) + relocations.size() * sizeof(RelocationRecord) +
+                    sectionRecords.size() * sizeof(SectionRecord);
+
+  for (SectionRecord &record : sectionRecords)
+  {
+    record.offset = offset;
+    offset += align8(record.size);
+  }
+
+  FileHeader header = {MYELF_MAGIC, MYELF_VERSION, (uint32_t)symbols.size(), (uint32_t)tables.size(),
+                       (uint32_t)relocations.size(), (uint32_t)sectionRecords.size(), (uint32_t)strings.size(), 0};
+
+  outputFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outputFile.write(strings.data(), strings.size());
+  outputFile.write(reinterpret_cast<const char *>(symbols.data()), symbols.size() * sizeof(SymbolRecord));
+  outputFile.write(reinterpret_cast<const char *>(tables.data()), tables.size() * sizeof(RelocationTableRecord));
+  outputFile.write(reinterpret_cast<const char *>(relocations.data()), relocations.size() * sizeof(RelocationRecord));
+  outputFile.write(reinterpret_cast<const char *>(sectionRecords.data()), sectionRecords.size() * sizeof(SectionRecord));
+
+  const char padding[8] = {};
+  for (size_t i = 0; i < contents.size(); i++)
+  {
+    Section *section = contents[i];
+    outputFile.write(section->memory.data(), section->memory.size());
+    outputFile.write(reinterpret_cast<const char *>(section->literalPool.data()), section->literalPool.size() * sizeof(int));
+    outputFile.write(padding, align8(sectionRecords[i].size) - sectionRecords[i].size);
+  }
+
+  outputFile.flush();
+}
+
+
+// Load ELF file of either format (binary files are recognized by the magic number)
+MyElf *MyElf::load(string fileName)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr; // Invalid file
+
+  uint32_t magic = 0;
+  if (pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) && magic == MYELF_MAGIC)
+  {
+    MyElf *myElf = readBinary(fd);
+    close(fd);
+    return myElf;
+  }
+
+  close(fd);
+
+  FILE *inputFile = fopen(fileName.c_str(), "r");
+  if (!inputFile)
+    return nullptr;
+
+  MyElf *myElf = read(inputFile);
+  fclose(inputFile);
+  return myElf;
+}
+
+
+// Read binary ELF file. File is mapped privately and section contents point
+// into the mapping, so nothing is copied and relocations never reach the file.
+MyElf *MyElf::readBinary(int fd)
+{
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(FileHeader))
+    return nullptr;
+
+  size_t size = st.st_size;
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+
+  MyElf *myElf = new MyElf();
+  myElf->mapping = mapping;
+  myElf->mappingSize = size;
+
+  char *base = static_cast<char *>(mapping);
+  const FileHeader *header = reinterpret_cast<const FileHeader *>(base);
+
+  size_t tablesEnd = sizeof(FileHeader) + (size_t)header->stringTableSize +
+                     (size_t)header->numOfSymbols * sizeof(SymbolRecord) +
+                     (size_t)header->numOfRelocationTables * sizeof(RelocationTableRecord) +
+                     (size_t)header->numOfRelocations * sizeof(RelocationRecord) +
+                     (size_t)header->numOfSections * sizeof(SectionRecord);
+
+  if (header->version != MYELF_VERSION || tablesEnd > size || header->stringTableSize == 0 ||
+      base[sizeof(FileHeader) + header->stringTableSize - 1] != '\0')
+  {
+    delete myElf;
+    return nullptr; // Invalid file
+  }
+
+  const char *strings = base + sizeof(FileHeader);
+  const SymbolRecord *symbols = reinterpret_cast<const SymbolRecord *>(strings + header->stringTableSize);
+  const RelocationTableRecord *tables = reinterpret_cast<const RelocationTableRecord *>(symbols + header->numOfSymbols);
+  const RelocationRecord *relocations = reinterpret_cast<const RelocationRecord *>(tables + header->numOfRelocationTables);
+  const SectionRecord *sectionRecords = reinterpret_cast<const SectionRecord *>(relocations + header->numOfRelocations);
+
+  bool valid = true;
+
+  // One allocation per table
+  myElf->symbolTable.reserve(header->numOfSymbols);
+  myElf->relocationTables.reserve(header->numOfRelocationTables);
+  myElf->sections.reserve(header->numOfSections);
+
+  // -------------------------------- Symbol table --------------------------------
+
+  for (uint32_t i = 0; i < header->numOfSymbols && valid; i++)
+  {
+    const SymbolRecord &s = symbols[i];
+    valid = s.name < header->stringTableSize;
+    if (valid)
+      myElf->addSymbol(Symbol(myElf->names.intern(strings + s.name), s.value, s.isGlobal, s.isSection, s.sectionId));
+  }
+
+  // ------------------------------ Relocation tables ------------------------------
+
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < header->numOfRelocationTables && valid; i++)
+  {
+    const RelocationTableRecord &t = tables[i];
+    valid = t.sectionName < header->stringTableSize && t.numOfRelocations <= header->numOfRelocations - next;
+    if (!valid)
+      break;
+
+    myElf->relocationTables.emplace_back(t.sectionId, myElf->names.intern(strings + t.sectionName));
+    RelocationTable &relocationTable = myElf->relocationTables.back();
+    relocationTable.relocations.reserve(t.numOfRelocations);
+
+    for (uint32_t j = 0; j < t.numOfRelocations; j++, next++)
+    {
+      const RelocationRecord &r = relocations[next];
+      relocationTable.relocations.emplace_back(r.offset, (RelocationTypes)r.type, r.symbolId, r.addend);
+    }
+  }
+
+  // ------------------------------ Sections content ------------------------------
+
+  for (uint32_t i = 0; i < header->numOfSections && valid; i++)
+  {
+    const SectionRecord &s = sectionRecords[i];
+    valid = s.sectionName < header->stringTableSize && s.offset <= size && s.size <= size - s.offset;
+    if (!valid)
+      break;
+
+    myElf->sections.emplace_back(s.secId, myElf->names.intern(strings + s.sectionName));
+    Section &section = myElf->sections.back();
+    section.myElf = myElf;
+    section.data = base + s.offset;
+    section.size = s.size;
+  }
+
+  // ---------------------------- Indices used by linker ----------------------------
+
+  // Linker indexes tables with these ids without checking them
+  uint32_t numOfSymbols = header->numOfSymbols;
+
+  for (uint32_t i = 0; i < numOfSymbols && valid; i++)
+    valid = symbols[i].sectionId >= 0 && (uint32_t)symbols[i].sectionId < numOfSymbols;
+
+  for (uint32_t i = 0; i < header->numOfSections && valid; i++)
+    valid = sectionRecords[i].secId >= 0 && (uint32_t)sectionRecords[i].secId < numOfSymbols;
+
+  for (RelocationTable &relocationTable : myElf->relocationTables)
+  {
+    Section *section = valid && relocationTable.sectionId >= 0 && (uint32_t)relocationTable.sectionId < numOfSymbols
+                           ? myElf->findSection(relocationTable.sectionId)
+                           : nullptr;
+    valid = section != nullptr;
+
+    for (Relocation &r : relocationTable.relocations)
+    {
+      if (!valid)
+        break;
+      valid = r.symbolId >= 0 && (uint32_t)r.symbolId < numOfSymbols &&
+              r.offset >= 0 && r.offset <= section->size - 4;
+    }
+  }
+
+  if (!valid)
+  {
+    delete myElf;
+    return nullptr; // Invalid file
+  }
+
+  return myElf;
+}
+
+
+void MyElf::unmap()
+{
+  if (mapping)
+    munmap(mapping, mappingSize);
+
+  mapping = nullptr;
+  mappingSize = 0;
+}
@@ -0,0 +1,129 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "../inc/symbolMap.h"
+#include "../inc/trace.h"
+
+using namespace std;
+
+// Prints an execution trace of the emulator (--trace), one line per
+// instruction or interrupt, with addresses symbolized by the linker's map:
+//
+//   decoder [--map=program.map] program.trace
+
+static const char *operationNames[] = {"halt", "int", "call", "jmp", "xchg", "ari", "log", "sh", "st", "ld"};
+
+string traceFileName;
+string mapFileName;
+
+SymbolMap symbols;
+
+void loadArguments(int argc, char **argv);
+
+string hexWord(uint32_t value) {
+  stringstream ss;
+  ss << "0x" << hex << setw(8) << setfill('0') << value;
+  return ss.str();
+}
+
+// Symbol with the offset of the address in it
+string location(uint32_t address) {
+  const SymbolMap::Symbol *symbol = symbols.symbolAt(address);
+  if (!symbol) return "";
+
+  stringstream ss;
+  ss << symbol->name;
+  if (address != symbol->address) ss << "+0x" << hex << address - symbol->address;
+  return ss.str();
+}
+
+void printRecord(const TraceRecord &record) {
+  stringstream line;
+
+  line << hexWord(record.address) << "  " << setw(20) << left << location(record.address) << right << "  ";
+
+  if (record.interrupt) {
+    line << "interrupt " << dec << (unsigned)record.interrupt;
+  }
+  else {
+    // Instruction bytes in memory order, the first one is OC|M
+    unsigned OC = (record.raw >> 4) & 0xF;
+    line << setw(5) << left << (OC < 10 ? operationNames[OC] : "?") << right << hex << setfill('0');
+    for (int i = 0; i < 4; i++) line << setw(2) << ((record.raw >> (8 * i)) & 0xFF) << (i < 3 ? " " : "");
+    line << setfill(' ');
+  }
+
+  for (int i = 0; i < record.numOfRegs; i++)
+    line << "  r" << dec << (unsigned)record.regs[i] << "=" << hexWord(record.values[i]);
+
+  if (record.write)
+    line << "  [" << hexWord(record.writeAddress) << "]=" << hexWord(record.writeValue);
+
+  cout << line.str() << '\n';
+}
+
+int main(int argc, char **argv) {
+
+  loadArguments(argc, argv);
+
+  ifstream traceFile(traceFileName, ios::binary);
+  stringstream content;
+  content << traceFile.rdbuf();
+  string data = content.str();
+
+  TraceHeader header;
+  if (!traceFile.is_open() || data.size() < sizeof(header)) {
+    cout << "Can't read trace " << traceFileName << "!" << endl;
+    exit(-2);
+  }
+
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+    cout << traceFileName << " isn't a trace of this emulator version!" << endl;
+    exit(-2);
+  }
+
+  if (!mapFileName.empty() && !symbols.load(mapFileName)) {
+    cout << "Can't read symbol map " << mapFileName << "!" << endl;
+    exit(-2);
+  }
+
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(data.data()) + sizeof(header);
+  const uint8_t *end = reinterpret_cast<const uint8_t *>(data.data()) + data.size();
+
+  TraceState state;
+  TraceRecord record;
+
+  while (in < end) {
+    if (!traceDecode(in, end, state, record)) {
+      cout << "Trace " << traceFileName << " is truncated!" << endl;
+      exit(-2);
+    }
+    printRecord(record);
+  }
+
+  return 0;
+}
+
+
+void loadArguments(int argc, char **argv) {
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+
+    if (arg.find("--map=") == 0) {
+      mapFileName = arg.substr(6);
+    }
+    else {
+      traceFileName = arg;
+    }
+  }
+
+  if (traceFileName.empty()) {
+    cout << "Input file isn't specified!" << endl;
+    exit(-1);
+  }
+}
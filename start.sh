@@ -18,7 +18,8 @@ ${EMULATOR} program.hex
 
 #bison -d misc/parser.y
 #flex misc/lexer.l
-#g++ parser.tab.c lex.yy.c src/myElf.cpp src/assembler.cpp src/assemblerControl.cpp -lfl -o assembler
-#g++ src/myElf.cpp src/linkerRelocations.cpp src/linkerSections.cpp src/linkerSymbols.cpp src/linker.cpp src/linkerControl.cpp -o linker
-#g++ src/emulator.cpp src/emulatorControl.cpp -o emulator
+#g++ parser.tab.c lex.yy.c src/myElf.cpp src/myElfBinary.cpp src/assembler.cpp src/assemblerControl.cpp -lfl -o assembler
+#g++ src/myElf.cpp src/myElfBinary.cpp src/linkerRelocations.cpp src/linkerSections.cpp src/linkerSymbols.cpp src/linkerMap.cpp src/linker.cpp src/linkerControl.cpp -pthread -o linker
+#g++ src/guestMemory.cpp src/emulator.cpp src/emulatorThreaded.cpp src/emulatorBlocks.cpp src/emulatorDevices.cpp src/emulatorSnapshot.cpp src/emulatorFork.cpp src/emulatorCores.cpp src/emulatorStats.cpp src/emulatorProfile.cpp src/emulatorTrace.cpp src/emulatorControl.cpp -pthread -o emulator
+#g++ src/traceDecoder.cpp -o decoder
 
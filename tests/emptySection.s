@@ -0,0 +1,17 @@
+# file: emptySection.s
+
+# Empty section zzz is placed where the code of my_code starts (see
+# emptySection.sh), so the map must still find symbols of my_code.
+
+.global start
+
+.section zzz
+
+.section my_code
+start:
+    ld $1, %r1
+    ld $2, %r2
+    add %r1, %r2
+    halt
+
+.end
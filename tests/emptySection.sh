@@ -0,0 +1,28 @@
+# Symbol map with an empty section placed at the start of the code: every
+# traced instruction must be named after start, not shown as a bare address.
+#
+#   tests/emptySection.sh
+#
+# Tools are taken from ASSEMBLER, LINKER, EMULATOR and DECODER like in start.sh.
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+LINKER=${LINKER:-./linker}
+EMULATOR=${EMULATOR:-./emulator}
+DECODER=${DECODER:-./decoder}
+
+WORK=$(mktemp -d)
+trap "rm -rf ${WORK}" EXIT
+
+${ASSEMBLER} -o ${WORK}/emptySection.o $(dirname $0)/emptySection.s || exit 1
+${LINKER} -hex -map=${WORK}/emptySection.map -place=zzz@0x40000000 \
+  -o ${WORK}/emptySection.hex ${WORK}/emptySection.o || exit 1
+${EMULATOR} --trace=${WORK}/emptySection.trace ${WORK}/emptySection.hex < /dev/null > /dev/null || exit 1
+${DECODER} --map=${WORK}/emptySection.map ${WORK}/emptySection.trace > ${WORK}/trace.txt || exit 1
+
+if [ $(wc -l < ${WORK}/trace.txt) -ne 4 ] || [ $(awk '$2 !~ /^start/' ${WORK}/trace.txt | wc -l) -ne 0 ]; then
+  echo "emptySection: instructions not named after start"
+  cat ${WORK}/trace.txt
+  exit 1
+fi
+
+echo "emptySection: ok"